@@ -47,11 +47,34 @@ Change log:
 
 #pragma once
 
+#include "harmony/Config.h"
 #include "harmony/utils.h"
+#include "harmony/Instrumentation.h"
+#include "harmony/Allocation.h"
+#include "harmony/LRUCache.h"
 #include "harmony/Note.h"
+#include "harmony/Tuning.h"
+#include "harmony/RomanNumeral.h"
 #include "harmony/Interval.h"
 #include "harmony/Intervals.h"
+#include "harmony/ChordSignature.h"
+#include "harmony/ChordVocabulary.h"
+#include "harmony/Voicing.h"
+#include "harmony/DiatonicTable.h"
 #include "harmony/Chord.h"
 #include "harmony/Diatonic.h"
 #include "harmony/Scale.h"
 #include "harmony/Progression.h"
+#include "harmony/VoicingGenerator.h"
+#include "harmony/Fretboard.h"
+#include "harmony/Reharmonizer.h"
+#include "harmony/ChordDecomposer.h"
+#include "harmony/SetClass.h"
+#include "harmony/NeoRiemannian.h"
+#include "harmony/ProgressionIndex.h"
+#include "harmony/ProgressionPatterns.h"
+#include "harmony/PitchTracker.h"
+#include "harmony/FFT.h"
+#include "harmony/Chromagram.h"
+#include "harmony/ChordRecognizer.h"
+#include "harmony/MidiSegmenter.h"
@@ -0,0 +1,247 @@
+/*
+ *  Allocation.h
+ *  MusicTheory
+ *
+ *  Pluggable allocation for the Note, Chord and Scale factories.
+ *
+ *  Every factory goes through Allocation::make, which does a single
+ *  allocate_shared (object and control block together) from the memory
+ *  resource installed on the calling thread. By default that is the
+ *  normal heap. For an analysis pass that creates and drops lots of
+ *  objects install a ScopedArena or ScopedPool for the duration:
+ *
+ *  {
+ *      ScopedArena arena;
+ *      ... analysis, all factories on this thread allocate from the arena
+ *  }   //everything released at once
+ *
+ *  Objects made inside a scope must not outlive it. To keep something,
+ *  copy() it under a ScopedHeap before leaving. The library's own caches
+ *  do that already.
+ *
+ */
+
+#ifndef _Allocation
+#define _Allocation
+
+#include <memory>
+#include <memory_resource>
+#include <cstddef>
+
+#include "Instrumentation.h"
+
+namespace MusicTheory{
+
+	/*
+	 Counters for objects created through the factories on one thread.
+	 Deallocations are counted on the thread that drops the last reference.
+	 */
+	struct AllocationStats {
+		size_t allocations = 0;
+		size_t deallocations = 0;
+		size_t bytes = 0;
+
+		AllocationStats operator-(const AllocationStats& other) const {
+			AllocationStats s;
+			s.allocations = allocations - other.allocations;
+			s.deallocations = deallocations - other.deallocations;
+			s.bytes = bytes - other.bytes;
+			return s;
+		}
+	};
+
+
+
+class Allocation {
+
+  public:
+
+	/*
+	 Allocator handed to allocate_shared. It remembers the resource it
+	 allocated from so the control block frees to the right place even if
+	 the thread has switched resource since.
+	 */
+	template <class T>
+	struct Allocator {
+		typedef T value_type;
+
+		std::pmr::memory_resource* resource;
+
+		Allocator(std::pmr::memory_resource* r = Allocation::getResource()) : resource(r) {}
+
+		template <class U>
+		Allocator(const Allocator<U>& other) : resource(other.resource) {}
+
+		T* allocate(size_t n) {
+			AllocationStats& s = Allocation::stats();
+			s.allocations++;
+			s.bytes += n * sizeof(T);
+			return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, size_t n) {
+			Allocation::stats().deallocations++;
+			resource->deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		template <class U>
+		bool operator==(const Allocator<U>& other) const {
+			return resource == other.resource;
+		}
+
+		template <class U>
+		bool operator!=(const Allocator<U>& other) const {
+			return resource != other.resource;
+		}
+	};
+
+
+	/*
+	 What every factory calls instead of shared_ptr<T>(new T(...)).
+	 {{{
+	 >>> NotePtr n = Allocation::make<Note>("C", 4);
+	 }}}
+	 */
+	template <class T, class... Args>
+	static std::shared_ptr<T> make(Args&&... args) {
+		MUSICTHEORY_COUNT(Instrumentation::getAllocationCounter<T>());
+		return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+	}
+
+
+	/*
+	 Resource used by the factories on this thread.
+	 */
+	static std::pmr::memory_resource* getResource() {
+		std::pmr::memory_resource* r = current();
+		return r ? r : std::pmr::new_delete_resource();
+	}
+
+	/*
+	 Installs a resource for this thread, nullptr goes back to the heap.
+	 Returns the previous one. ScopedArena and ScopedPool do this for you.
+	 */
+	static std::pmr::memory_resource* setResource(std::pmr::memory_resource* r) {
+		std::pmr::memory_resource* previous = current();
+		current() = r;
+		return previous;
+	}
+
+
+	/*
+	 Factory allocation counters for this thread.
+	 {{{
+	 AllocationStats before = Allocation::getStats();
+	 Chord::determine(notes);
+	 AllocationStats used = Allocation::getStats() - before;
+	 }}}
+	 */
+	static AllocationStats getStats() {
+		return stats();
+	}
+
+	static void resetStats() {
+		stats() = AllocationStats();
+	}
+
+
+  private:
+
+	static std::pmr::memory_resource*& current() {
+		thread_local std::pmr::memory_resource* resource = nullptr;
+		return resource;
+	}
+
+	static AllocationStats& stats() {
+		thread_local AllocationStats s;
+		return s;
+	}
+
+};//class
+
+
+
+/*
+ Monotonic arena for one analysis on the current thread. Frees are no-ops,
+ all memory goes back when the arena is destroyed.
+ */
+class ScopedArena {
+
+  public:
+
+	ScopedArena(size_t initialSize = 64 * 1024) : arena(initialSize) {
+		previous = Allocation::setResource(&arena);
+	}
+
+	~ScopedArena() {
+		Allocation::setResource(previous);
+	}
+
+	ScopedArena(const ScopedArena&) = delete;
+	ScopedArena& operator=(const ScopedArena&) = delete;
+
+  private:
+
+	std::pmr::monotonic_buffer_resource arena;
+	std::pmr::memory_resource* previous;
+
+};//class
+
+
+
+/*
+ Like ScopedArena but freed objects are recycled, better for long passes
+ that keep few objects alive at a time. Single thread only.
+ */
+class ScopedPool {
+
+  public:
+
+	ScopedPool() {
+		previous = Allocation::setResource(&pool);
+	}
+
+	~ScopedPool() {
+		Allocation::setResource(previous);
+	}
+
+	ScopedPool(const ScopedPool&) = delete;
+	ScopedPool& operator=(const ScopedPool&) = delete;
+
+  private:
+
+	std::pmr::unsynchronized_pool_resource pool;
+	std::pmr::memory_resource* previous;
+
+};//class
+
+
+
+/*
+ Back to the heap for the duration, for anything that must outlive the
+ caller's arena such as the static key and chord caches.
+ */
+class ScopedHeap {
+
+  public:
+
+	ScopedHeap() {
+		previous = Allocation::setResource(nullptr);
+	}
+
+	~ScopedHeap() {
+		Allocation::setResource(previous);
+	}
+
+	ScopedHeap(const ScopedHeap&) = delete;
+	ScopedHeap& operator=(const ScopedHeap&) = delete;
+
+  private:
+
+	std::pmr::memory_resource* previous;
+
+};//class
+
+}//namespace
+
+#endif
@@ -89,44 +89,45 @@
 #ifndef _Chord
 #define _Chord
 
+#include <algorithm>
 #include <cmath>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <deque>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <mutex>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 
+#include "Config.h"
 #include "utils.h"
 #include "Note.h"
 #include "Interval.h"
+#include "ChordSignature.h"
+#include "ChordVocabulary.h"
+#include "Voicing.h"
+#include "DiatonicTable.h"
 
 namespace MusicTheory {
 
-	class Chord;//forward declaration for these cache containers
-
-
 	typedef std::map<std::string, std::string> Lookup;
 
 
-
-	//A cache for composed triads
-	static std::map<std::string, std::vector<std::shared_ptr<Chord>>> _triads_cache;
-
-	//A cache for composed sevenths
-	static std::map<std::string, std::vector<std::shared_ptr<Chord>>> _sevenths_cache;
-
-
 	/*
 	 A dictionairy that can be used to present
 	 lookup chord abbreviations. This dictionairy is also
 	 used in determine_seventh()
 	 */
-	static Lookup ChordLookup = {
+#ifdef MUSICTHEORY_TABLES_EXTERN
+	Lookup makeChordLookup();
+#else
+	MUSICTHEORY_INLINE Lookup makeChordLookup() {
+		return {
 
 		//Triads
 		{"m"," minor triad"},
@@ -218,7 +219,10 @@ namespace MusicTheory {
 		{"hendrix"," hendrix chord"},
 		{"7b12"," hendrix chord"},
 		{"5"," perfect fifth"}
-	};
+		};
+	}
+#endif
+	inline constexpr LazyTable<Lookup, &makeChordLookup> ChordLookup;
 
 
 
@@ -253,7 +257,7 @@ namespace MusicTheory {
 					name = c->name;
 					notes = c->notes;
 
-					NotePtr r = NotePtr(new Note(getRootNote(_name)));
+					NotePtr r = Allocation::make<Note>(getRootNote(_name));
 					setRoot(r);
 				}
 #ifdef LOGS
@@ -326,13 +330,8 @@ namespace MusicTheory {
 
 		//the python version of this is rubbish
 		static std::shared_ptr<Chord> fromShorthand(std::string shorthand_string) {
-			//Shrink shorthand_string to a format recognised by chord_shorthand
-			boost::replace_all(shorthand_string, "min", "m");
-			boost::replace_all(shorthand_string, "mi", "m");
-			boost::replace_all(shorthand_string, "-", "m");
-			boost::replace_all(shorthand_string, "maj", "M");
-			boost::replace_all(shorthand_string, "ma", "M");
-
+			MUSICTHEORY_TIME(InstrumentTimer::ChordFromShorthand);
+			shorthand_string = Chord::cleanShorthand(shorthand_string);
 
 			auto slash = utils::splitString(shorthand_string, "/");
 			auto poly = utils::splitString(shorthand_string, "|");
@@ -367,7 +366,7 @@ namespace MusicTheory {
 			if (poly.size() == 2) {
 				//get polychord
 				std::string name = Chord::getRootNote(poly[1]);
-				NotePtr note = NotePtr(new Note(name));
+				NotePtr note = Allocation::make<Note>(name);
 				std::string chordSymbol = Chord::getChordSymbol(poly[1]);//was top?
 				std::shared_ptr<Chord> chord2 = Chord::chordFromShorthand(chordSymbol, note);
 				std::shared_ptr<Chord> subchord = Chord::create();
@@ -391,7 +390,7 @@ namespace MusicTheory {
 			}
 			else if (isSlashChord) {
 				//add bass from slash chord..needs to be checked for format
-				NotePtr bass = NotePtr(new Note(slash[1]));
+				NotePtr bass = Allocation::make<Note>(slash[1]);
 
 				chord->setBass(bass);
 
@@ -416,12 +415,26 @@ namespace MusicTheory {
 
 
 
+		/*
+		 Shrinks min, mi, -, maj and ma to the m and M that chordFromShorthand knows.
+		 >>> Chord::cleanShorthand("Bbmaj7") -> "BbM7"
+		 */
+		static std::string cleanShorthand(std::string shorthand_string) {
+			boost::replace_all(shorthand_string, "min", "m");
+			boost::replace_all(shorthand_string, "mi", "m");
+			boost::replace_all(shorthand_string, "-", "m");
+			boost::replace_all(shorthand_string, "maj", "M");
+			boost::replace_all(shorthand_string, "ma", "M");
+			return shorthand_string;
+		}
+
+
 		static std::shared_ptr<Chord>create(std::string _name = "") {
-			return std::shared_ptr<Chord>(new Chord(_name));
+			return Allocation::make<Chord>(_name);
 		}
 
 		std::shared_ptr<Chord> copy() {
-			std::shared_ptr<Chord>s = std::shared_ptr<Chord>(new Chord(*this));
+			std::shared_ptr<Chord>s = Allocation::make<Chord>(*this);
 			s->notes.clear();
 			for (NotePtr n : notes) {
 				s->notes.push_back(n->copy());
@@ -462,18 +475,23 @@ namespace MusicTheory {
 			if (!isValid()) {
 				return "Invalid chord";
 			}
+			updateAnalysis();
+			//no copies needed here, notes[0] is the bass once the analysis is current
+			const Note& bass = *notes[0];
+			const Note& r = root ? *root : bass;
+
 			std::string fullName;
-			if (getBass()->getName() != getRoot()->getName()) {
+			if (bass.name != r.name) {
 				//slash chord
-				fullName = getRoot()->getDiatonicName() + name + "/" + getBass()->getDiatonicName();
+				fullName = r.getDiatonicName() + name + "/" + bass.getDiatonicName();
 			}
 			else if (polychords.size() > 0) {
 				//ignoring for the moment more than one nested polychord...
-				fullName = getRoot()->getDiatonicName() + name + "/" + getBass()->getDiatonicName() + "|" + polychords[0]->getName();
+				fullName = r.getDiatonicName() + name + "/" + bass.getDiatonicName() + "|" + polychords[0]->getName();
 			}
 			else {
 				//normal chord
-				fullName = getRoot()->getDiatonicName() + name;
+				fullName = r.getDiatonicName() + name;
 			}
 			return fullName;
 		}
@@ -522,7 +540,7 @@ namespace MusicTheory {
 		 Returns the lowest note.
 		 */
 		NotePtr getBass() {
-			sort(notes.begin(), notes.end(), Note::comparePtr);
+			updateAnalysis();
 			if (notes.size()) {
 				return notes[0]->copy();
 			}
@@ -535,6 +553,35 @@ namespace MusicTheory {
 
 		}
 
+		/*
+		 Midi number of the lowest note, eg. 60 for C-3.
+		 */
+		int getBassPitch() {
+			updateAnalysis();
+			return cachedBassPitch;
+		}
+
+		/*
+		 Semitones from the bass up to the root, 0 in root position.
+		 >>> Chord::create("C/E")->getRootOffset()
+		 8
+		 */
+		int getRootOffset() {
+			updateAnalysis();
+			return cachedRootOffset;
+		}
+
+		/*
+		 Pitch classes of the chord relative to its root as a 12 bit set.
+		 Bit 0 is the root, bit 4 a major third, bit 10 a minor seventh and so on.
+		 >>> Chord::create("C7")->getIntervalSignature()
+		 1169 (0b010010010001)
+		 */
+		int getIntervalSignature() {
+			updateAnalysis();
+			return cachedSignature;
+		}
+
 		void setBass(NotePtr bass) {
 			if (notes.size()) {
 				NotePtr n = bass->copy();//copy
@@ -628,37 +675,21 @@ namespace MusicTheory {
 
 
    /*
-   Note: isDominant will report true for isMajor as well. Best to check that first.
+   Quality predicates are bit tests on the cached interval signature,
+   see ChordSignature. They no longer build a root position copy.
 
+   Note: isDominant will report true for isMajor as well. Best to check that first.
    */
 		bool isMajor() {
-			if (!isValid()) {
-				return false;
-			}
-
-			std::shared_ptr<Chord> copy = rootPosition();
-			return Interval::measure(copy->notes[0], copy->notes[1]) == 4;
+			return isValid() && ChordSignature::isMajor(getIntervalSignature());
 		}
 
 		bool isMinor() {
-			if (!isValid()) {
-				return false;
-			}
-
-			std::shared_ptr<Chord> copy = rootPosition();
-			return Interval::measure(copy->notes[0], copy->notes[1]) == 3;
+			return isValid() && ChordSignature::isMinor(getIntervalSignature());
 		}
 
 		bool isDominant() {
-			if (!isValid()) {
-				return false;
-			}
-			std::shared_ptr<Chord> copy = rootPosition();
-			if (!(copy->notes.size() >= 4)) {
-				return false;
-			}
-
-			return Interval::measure(copy->notes[0], copy->notes[1]) == 4 && Interval::measure(copy->notes[0], copy->notes[3]) == 10;
+			return isValid() && ChordSignature::isDominant(getIntervalSignature());
 		}
 
 		/*
@@ -666,27 +697,23 @@ namespace MusicTheory {
 		*/
 
 		bool isDiminished() {
-			if (!isValid()) {
-				return false;
-			}
-			std::shared_ptr<Chord> copy = rootPosition();
-			if (!(copy->notes.size() >= 3)) {
-				return false;
-			}
-
-			return Interval::measure(copy->notes[0], copy->notes[1]) == 3 && Interval::measure(copy->notes[0], copy->notes[2]) == 6;
+			return isValid() && ChordSignature::isDiminished(getIntervalSignature());
 		}
 
 		bool isSuspended() {
+			return isValid() && ChordSignature::isSuspended(getIntervalSignature());
+		}
+
+		/*
+		 Family, extensions and altered tones in one go.
+		 >>> Chord::create("C7b9")->getQuality().has(ChordSignature::FLAT_NINTH)
+		 true
+		 */
+		ChordQuality getQuality() {
 			if (!isValid()) {
-				return false;
-			}
-			std::shared_ptr<Chord> copy = rootPosition();
-			if (!(copy->notes.size() >= 3)) {
-				return false;
+				return ChordQuality();
 			}
-
-			return Interval::measure(copy->notes[0], copy->notes[1]) == 5;
+			return ChordSignature::classify(getIntervalSignature());
 		}
 
 
@@ -764,20 +791,16 @@ namespace MusicTheory {
 			}
 		}
 
+		//find, not [], so looking up never adds to ChordLookup
 		static bool isValidName(std::string str) {
-			std::string name = ChordLookup[str];
-			if (name.size() > 0) {
-				return true;
-			}
-			else {
-				return false;
-			}
+			auto it = ChordLookup.find(str);
+			return it != ChordLookup.end() && it->second.size() > 0;
 		}
 
 		static std::string getFullName(std::string str) {
-			std::string name = ChordLookup[str];//map entries without key instantiates to empty std::string
-			if (name.size() > 0) {
-				return name;
+			auto it = ChordLookup.find(str);
+			if (it != ChordLookup.end() && it->second.size() > 0) {
+				return it->second;
 			}
 			else {
 				return "Chord not found";
@@ -785,97 +808,56 @@ namespace MusicTheory {
 
 		}
 
-		static std::vector<std::string> getAllKnownChords() {
-			static std::vector<std::string> _allchords;
-
-			if (_allchords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					_allchords.push_back(iterator->first);
+		/*
+		 Every symbol indexed by category, family, quality and interval, see
+		 ChordVocabulary. Built on first use, safe to call from several threads.
+		 {{{
+		 >>> const ChordVocabulary& v = Chord::getVocabulary();
+		 >>> v.getSymbols(v.dominant & v.withQuality(ChordSignature::SHARP_NINTH))
+		 ["+#9", "+7#9", "7#5#9", "7#9", "7#9#5", "7#9b13", "7+#9", "7b12", "hendrix"]
+		 }}}
+		 */
+		static const ChordVocabulary& getVocabulary() {
+			static const ChordVocabulary vocabulary = []() {
+				ChordVocabulary v;
+				for (const std::string& symbol : Chord::getSymbols()) {
+					std::shared_ptr<Chord> chord = Chord::create("C" + symbol);
+					v.add(symbol, chord->isValid() ? chord->getIntervalSignature() : 0, Chord::isValidName(symbol));
 				}
-			}
-			return _allchords;
+				return v;
+			}();
+			return vocabulary;
 		}
 
-
+		//symbols in ChordLookup
+		static std::vector<std::string> getAllKnownChords() {
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named);
+		}
 
 		static std::vector<std::string> getAllMajorChords() {
-			static std::vector<std::string> _allmajchords;
-
-			if (_allmajchords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					std::shared_ptr<Chord>chord = Chord::create("C" + iterator->first);
-					if (chord->isMajor()) {
-						_allmajchords.push_back(iterator->first);
-					}
-				}
-			}
-			return _allmajchords;
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named & v.major);
 		}
 
-
-
 		static std::vector<std::string> getAllMinorChords() {
-			static std::vector<std::string> _allminchords;
-
-			if (_allminchords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					std::shared_ptr<Chord>chord = Chord::create("C" + iterator->first);
-					if (chord->isMinor()) {
-						_allminchords.push_back(iterator->first);
-					}
-				}
-			}
-			return _allminchords;
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named & v.minor);
 		}
 
-
 		static std::vector<std::string> getAllDominantChords() {
-			static std::vector<std::string> _alldomchords;
-
-			if (_alldomchords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					std::shared_ptr<Chord>chord = Chord::create("C" + iterator->first);
-					if (chord->isDominant()) {
-						_alldomchords.push_back(iterator->first);
-					}
-				}
-			}
-			return _alldomchords;
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named & v.dominant);
 		}
 
 		static std::vector<std::string> getAllDiminishedChords() {
-			static std::vector<std::string> _alldimchords;
-
-			if (_alldimchords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					std::shared_ptr<Chord>chord = Chord::create("C" + iterator->first);
-					if (chord->isDiminished()) {
-						_alldimchords.push_back(iterator->first);
-					}
-				}
-			}
-			return _alldimchords;
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named & v.diminished);
 		}
 
-
 		static std::vector<std::string> getAllSuspendedChords() {
-			static std::vector<std::string> _allsuschords;
-
-			if (_allsuschords.size() == 0) {
-				typedef std::map<std::string, std::string>::iterator it_type;
-				for (it_type iterator = ChordLookup.begin(); iterator != ChordLookup.end(); iterator++) {
-					std::shared_ptr<Chord>chord = Chord::create("C" + iterator->first);
-					if (chord->isSuspended()) {
-						_allsuschords.push_back(iterator->first);
-					}
-				}
-			}
-			return _allsuschords;
+			const ChordVocabulary& v = Chord::getVocabulary();
+			return v.getSymbols(v.named & v.suspended);
 		}
 
 
@@ -899,6 +881,7 @@ namespace MusicTheory {
 			}*/
 
 
+			MUSICTHEORY_COUNT(InstrumentCounter::RegexCompile);
 			boost::regex rex{ "\/[a-gA-G]" };//find accidentals
 			boost::smatch match;
 			if (boost::regex_search(_name, match, rex))
@@ -944,25 +927,12 @@ namespace MusicTheory {
 
 
 		/*
-		 Returns all the triads in key. Implemented using a cache.
+		 Returns copies of all the triads in key.
+		 To read them without copying use getDiatonicTable(key)->triads.
 		*/
 
 		static std::vector<std::shared_ptr<Chord>> triads(NotePtr key) {
-			if (_triads_cache[key->name].size() > 0) {
-				return Chord::copyCache(_triads_cache[key->name]);
-			}
-
-			std::deque<NotePtr> triads = Diatonic::getNotes(key);
-
-			std::vector<std::shared_ptr<Chord>> chords;
-			for (int i = 0; i < triads.size(); i++) {
-				std::shared_ptr<Chord> chord = Chord::triad(triads[i], key);
-				chords.push_back(chord);
-			}
-
-
-			_triads_cache[key->name] = Chord::copyCache(chords);
-			return chords;
+			return Chord::copyCache(Chord::getDiatonicTable(key)->triads);
 		}
 
 
@@ -1103,30 +1073,17 @@ namespace MusicTheory {
 
 
 		/*
-		 Returns all the sevenths in key. Implemented using a cache.
+		 Returns copies of all the sevenths in key.
+		 To read them without copying use getDiatonicTable(key)->sevenths.
 		 */
 
 		static std::vector<std::shared_ptr<Chord>> sevenths(NotePtr key) {
-			if (_sevenths_cache[key->name].size() > 0) {
-				return Chord::copyCache(_sevenths_cache[key->name]);
-			}
-
-			std::deque<NotePtr> triads = Diatonic::getNotes(key);
-
-			std::vector<std::shared_ptr<Chord>> chords;
-			for (int i = 0; i < triads.size(); i++) {
-				std::shared_ptr<Chord> chord = Chord::seventh(triads[i], key);
-				chords.push_back(chord);
-			}
-
-
-			_sevenths_cache[key->name] = Chord::copyCache(chords);
-			return chords;
+			return Chord::copyCache(Chord::getDiatonicTable(key)->sevenths);
 		}
 
 
 
-		static std::vector<std::shared_ptr<Chord>> copyCache(std::vector<std::shared_ptr<Chord>>cache) {
+		static std::vector<std::shared_ptr<Chord>> copyCache(const std::vector<std::shared_ptr<Chord>>& cache) {
 			std::vector<std::shared_ptr<Chord>> _copy_cache;
 			for (std::shared_ptr<Chord> chord : cache) {
 				_copy_cache.push_back(chord->copy());
@@ -2071,6 +2028,40 @@ namespace MusicTheory {
 			return chordCopy;
 		}
 
+		//===================================================================
+#pragma mark -		Diatonic tables
+//===================================================================
+
+		/*
+		 Triads and sevenths on every degree of key in mode. Built on first
+		 use and shared from then on: nothing is copied, so copy() a chord
+		 before changing it. Safe to call from several threads.
+		 {{{
+		 >>> Chord::getDiatonicTable(Note::create("A"), DiatonicMode::HarmonicMinor)->sevenths[4]->getName()
+		 "E7"
+		 }}}
+		 DiatonicMode::Major holds the chords Chord::triads and Chord::sevenths return.
+		 */
+		static DiatonicTablePtr getDiatonicTable(NotePtr key, DiatonicMode mode = DiatonicMode::Major) {
+			static std::mutex lock;
+			static std::map<std::string, DiatonicTablePtr> tables;
+
+			std::string id = key->name + std::to_string(key->getOctave()) + DiatonicModes::getName(mode);
+			std::lock_guard<std::mutex> guard(lock);
+			auto it = tables.find(id);
+			if (it != tables.end()) {
+				MUSICTHEORY_COUNT(InstrumentCounter::DiatonicTableHit);
+				return it->second;
+			}
+			MUSICTHEORY_COUNT(InstrumentCounter::DiatonicTableMiss);
+			ScopedHeap heap;//the tables outlive any arena the caller may have installed
+			DiatonicTablePtr table = Chord::buildDiatonicTable(key->copy(), mode);
+			tables[id] = table;
+			return table;
+		}
+
+
+
 		//===================================================================
 #pragma mark -		Chords by harmonic function
 //===================================================================
@@ -2088,7 +2079,7 @@ namespace MusicTheory {
 	 */
 
 		static std::shared_ptr<Chord> tonic(NotePtr key) {
-			return Chord::triads(key)[0];
+			return Chord::getDiatonicTable(key)->triads[0]->copy();
 		}
 
 
@@ -2098,7 +2089,7 @@ namespace MusicTheory {
 		 Same as tonic(key), but returns seventh chord instead     */
 
 		static std::shared_ptr<Chord> tonic7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[0];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[0]->copy();
 			return chord;
 		}
 
@@ -2113,7 +2104,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> supertonic(NotePtr key) {
-			return Chord::triads(key)[1];
+			return Chord::getDiatonicTable(key)->triads[1]->copy();
 		}
 
 
@@ -2126,7 +2117,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> supertonic7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[1];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[1]->copy();
 			return chord;
 		}
 
@@ -2142,7 +2133,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> mediant(NotePtr key) {
-			return Chord::triads(key)[2];
+			return Chord::getDiatonicTable(key)->triads[2]->copy();
 		}
 
 
@@ -2152,7 +2143,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> mediant7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[2];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[2]->copy();
 			//chord->name += "7";//added above already
 
 			return chord;
@@ -2171,7 +2162,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> subdominant(NotePtr key) {
-			return Chord::triads(key)[3];
+			return Chord::getDiatonicTable(key)->triads[3]->copy();
 		}
 
 
@@ -2182,7 +2173,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> subdominant7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[3];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[3]->copy();
 			//chord->name += "7";
 			return chord;
 
@@ -2198,7 +2189,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> dominant(NotePtr key) {
-			return Chord::triads(key)[4];
+			return Chord::getDiatonicTable(key)->triads[4]->copy();
 		}
 
 
@@ -2207,7 +2198,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> dominant7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[4];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[4]->copy();
 			//chord->name += "7";
 			return chord;
 
@@ -2223,7 +2214,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> submediant(NotePtr key) {
-			return Chord::triads(key)[5];
+			return Chord::getDiatonicTable(key)->triads[5]->copy();
 		}
 
 
@@ -2233,7 +2224,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> submediant7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[5];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[5]->copy();
 			//chord->name += "7";
 			return chord;
 		}
@@ -2278,7 +2269,7 @@ namespace MusicTheory {
 		}
 
 		static std::shared_ptr<Chord> leadingtone(NotePtr key) {
-			return Chord::triads(key)[6];
+			return Chord::getDiatonicTable(key)->triads[6]->copy();
 		}
 
 
@@ -2288,7 +2279,7 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> leadingtone7(NotePtr key) {
-			std::shared_ptr<Chord> chord = Chord::sevenths(key)[6];
+			std::shared_ptr<Chord> chord = Chord::getDiatonicTable(key)->sevenths[6]->copy();
 			return chord;
 		}
 
@@ -2445,25 +2436,119 @@ namespace MusicTheory {
 //===================================================================
 
 	/*
-	Root position
+	Root position. Works on the stored pitches and the root, every note below
+	the lowest root moves up by octaves. See Voicing for the plain pitch version.
+	Returns a copy.
 	*/
 
 		static std::shared_ptr<Chord> rootPosition(std::shared_ptr<Chord> chord) {
-			std::shared_ptr<Chord> newCopy = Chord::create(chord->getName());
-			return newCopy;
+			return chord->rootPosition();
 		}
 
 		std::shared_ptr<Chord> rootPosition() {
-			std::shared_ptr<Chord> newCopy = Chord::create(getName());
+			std::shared_ptr<Chord> newCopy = copy();
+			newCopy->toRootPosition();
+			return newCopy;
+		}
+
+		/*
+		 In place version of rootPosition. Moved notes are replaced by copies,
+		 so notes shared with other chords are left alone.
+		 */
+		void toRootPosition() {
+			if (!isValid()) {
+				return;
+			}
+			updateAnalysis();
+			int rootClass = Voicing::pitchClass(root ? root->toInt(true) : notes[0]->toInt(true));
+			int r = -1;
+			for (int i = 0; i < (int)notes.size() && r < 0; i++) {
+				if (Voicing::pitchClass(notes[i]->toInt()) == rootClass) {
+					r = i;
+				}
+			}
+			if (r <= 0) {
+				return;
+			}
+			int rootPitch = notes[r]->toInt();
+			for (int i = 0; i < r; i++) {
+				shiftNote(i, (rootPitch - notes[i]->toInt()) / 12 + 1);
+			}
+			updateAnalysis();
+		}
+
+		/*
+		 nth inversion counted from root position, 0 is root position.
+		 >>> Chord::create("C7")->getInversion(2)
+		 [G, Bb, C, E]
+		 Returns a copy.
+		 */
+		std::shared_ptr<Chord> getInversion(int n) {
+			std::shared_ptr<Chord> newCopy = copy();
+			newCopy->setInversion(n);
+			return newCopy;
+		}
+
+		void setInversion(int n) {
+			toRootPosition();
+			for (int i = 0; i < n && isValid(); i++) {
+				updateAnalysis();
+				shiftNote(0, 1);
+			}
+			updateAnalysis();
+		}
+
+		/*
+		 Drops the nth voice from the top an octave, drop(2) gives a drop-2 voicing.
+		 Works on the current voicing, so call toRootPosition or setInversion first
+		 for the textbook versions.
+		 */
+		void drop(int voice) {
+			updateAnalysis();
+			int i = (int)notes.size() - voice;
+			if (voice < 1 || i < 0) {
+				return;
+			}
+			shiftNote(i, -1);
+			updateAnalysis();
+		}
+
+		std::shared_ptr<Chord> getDrop2() {
+			std::shared_ptr<Chord> newCopy = copy();
+			newCopy->drop(2);
 			return newCopy;
 		}
 
+		std::shared_ptr<Chord> getDrop3() {
+			std::shared_ptr<Chord> newCopy = copy();
+			newCopy->drop(3);
+			return newCopy;
+		}
+
+		/*
+		 The chord as plain pitches for the non allocating Voicing operations.
+		 {{{
+		 Voicing v = chord->getVoicing();
+		 v.setInversion(chord->getRoot()->toInt(true), 1);
+		 v.drop(2);
+		 }}}
+		 */
+		Voicing getVoicing() {
+			updateAnalysis();
+			Voicing v;
+			for (NotePtr n : notes) {
+				v.add(n->toInt());
+			}
+			return v;
+		}
+
 		/*
 		This return a copy
 		*/
 		std::shared_ptr<Chord> invert() {
 			std::shared_ptr<Chord> c = copy();
-			return Chord::invert(c);
+			Chord::invert(c->notes);
+			return c;
 		}
 
 		/*
@@ -3020,6 +3105,7 @@ namespace MusicTheory {
 
 		/*
 		 Determines the polychords in chord. Can handle anything from polychords based on two triads to 6 note extended chords.
+		 ChordDecomposer ranks the same and slash chords too, without depending on note order.
 		 */
 
 
@@ -3050,6 +3136,7 @@ namespace MusicTheory {
 	 */
 
 		static std::vector<std::string>  determine(std::deque<NotePtr> chord, bool shorthand = false, bool allowInversions = true, bool allowPolychords = false) {
+			MUSICTHEORY_TIME(InstrumentTimer::ChordDetermine);
 			//cout<<"Chord::determine"<<std::endl;
 			std::vector<std::string> str;
 
@@ -3152,6 +3239,7 @@ namespace MusicTheory {
 				}
 
 			}
+			return "";//only a root with flats, eg. Db
 		}
 
 		//===================================================================
@@ -3162,7 +3250,63 @@ namespace MusicTheory {
 		 */
 
 		static std::shared_ptr<Chord> chordFromShorthand(std::string c, NotePtr note) {
-			static ChordShorthandFuncLookup  _chordFuncLookup = {
+			const ChordShorthandFuncLookup& lookup = Chord::getShorthandFunctions();
+			auto it = lookup.find(c);
+			if (it != lookup.end()) {
+				return it->second(note);
+			}
+			else {
+#ifdef LOGS
+				ofLog() << "Warning: Chord abbr " << note->getName() << " " << c << " not recognized" << std::endl;
+#endif // LOGS
+				return 0;
+			}
+
+			//
+							//ofSystemAlertDialog("Chord::chordFromShorthand: Chord "+note->getName()+c+" not recognized");
+
+		}
+
+
+		/*
+		 Small number for every symbol chordFromShorthand knows, -1 for any
+		 other. Ids follow the sorted symbols, so they only change when a
+		 symbol is added. Lets tables be indexed by chord type.
+		 {{{
+		 >>> Chord::getSymbol(Chord::getSymbolId("m7"))
+		 "m7"
+		 }}}
+		 */
+		static int getSymbolId(std::string_view symbol) {
+			const std::vector<std::string>& symbols = Chord::getSymbols();
+			auto it = std::lower_bound(symbols.begin(), symbols.end(), symbol, [](const std::string& a, std::string_view b) { return std::string_view(a) < b; });
+			return (it != symbols.end() && *it == symbol) ? (int)(it - symbols.begin()) : -1;
+		}
+
+		static const std::string& getSymbol(int id) {
+			static const std::string none;
+			const std::vector<std::string>& symbols = Chord::getSymbols();
+			return (id >= 0 && id < (int)symbols.size()) ? symbols[id] : none;
+		}
+
+		//every symbol chordFromShorthand knows, sorted, index = symbol id
+		static const std::vector<std::string>& getSymbols() {
+			static const std::vector<std::string> symbols = []() {
+				std::vector<std::string> v;
+				for (auto& entry : Chord::getShorthandFunctions()) {
+					v.push_back(entry.first);
+				}
+				return v;
+			}();
+			return symbols;
+		}
+
+		/*
+		 Symbol -> factory table behind chordFromShorthand. Only read after it
+		 is built, so it is safe to share between threads.
+		 */
+		static const ChordShorthandFuncLookup& getShorthandFunctions() {
+			static const ChordShorthandFuncLookup  _chordFuncLookup = {
 			{"m",&Chord::minorTriad},
 			{"M",&Chord::majorTriad},
 			{"",&Chord::majorTriad},
@@ -3276,22 +3420,7 @@ namespace MusicTheory {
 			{"7b12",&Chord::hendrixChord}
 
 			};
-
-
-
-			if (_chordFuncLookup[c]) {
-				return _chordFuncLookup[c](note);
-			}
-			else {
-#ifdef LOGS
-				ofLog() << "Warning: Chord abbr " << note->getName() << " " << c << " not recognized" << std::endl;
-#endif // LOGS
-				return 0;
-			}
-
-			//
-							//ofSystemAlertDialog("Chord::chordFromShorthand: Chord "+note->getName()+c+" not recognized");
-
+			return _chordFuncLookup;
 		}
 
 		//===================================================================
@@ -4058,6 +4187,129 @@ namespace MusicTheory {
 			return ", inversion unknown";
 		}
 
+		/*
+		 Keeps notes sorted on pitch and the bass, root offset and interval
+		 signature up to date. notes and the notes themselves are public and
+		 often shared between chords, so instead of trusting every caller to
+		 flag changes the pitches seen at the last update are compared here.
+		 That is one toInt per note and no allocation; the sort and the rest
+		 only run when something actually moved.
+		 */
+		void updateAnalysis() {
+			int size = notes.size();
+			int rootPitch = root ? root->toInt() : 0;
+			bool current = size == cachedSize && size <= CACHED_NOTES && rootPitch == cachedRootPitch;
+			for (int i = 0; current && i < size; i++) {
+				current = notes[i]->toInt() == cachedPitches[i];
+			}
+			if (current) {
+				return;
+			}
+
+			if (!std::is_sorted(notes.begin(), notes.end(), Note::comparePtr)) {
+				sort(notes.begin(), notes.end(), Note::comparePtr);
+			}
+
+			cachedSize = size;
+			cachedRootPitch = rootPitch;
+			cachedBassPitch = 0;
+			cachedRootOffset = 0;
+			cachedSignature = 0;
+			if (!size) {
+				return;
+			}
+
+			for (int i = 0; i < size && i < CACHED_NOTES; i++) {
+				cachedPitches[i] = notes[i]->toInt();
+			}
+			cachedBassPitch = notes[0]->toInt();
+			int rootClass = ((root ? root->toInt(true) : cachedBassPitch) % 12 + 12) % 12;
+			cachedRootOffset = ((rootClass - cachedBassPitch) % 12 + 12) % 12;
+			for (NotePtr n : notes) {
+				cachedSignature |= 1 << (((n->toInt() - rootClass) % 12 + 12) % 12);
+			}
+		}
+
+		static DiatonicTablePtr buildDiatonicTable(NotePtr key, DiatonicMode mode) {
+			std::shared_ptr<DiatonicTable> table = std::make_shared<DiatonicTable>();
+			table->mode = mode;
+			if (mode == DiatonicMode::Major) {
+				std::deque<NotePtr> notes = Diatonic::getNotes(key);
+				table->scale.assign(notes.begin(), notes.end());
+			}
+			else {
+				table->scale = DiatonicModes::getScale(key, mode);
+			}
+			for (int d = 0; d < (int)table->scale.size(); d++) {
+				table->triads.push_back(Chord::stackThirds(table->scale, d, 3));
+				table->sevenths.push_back(Chord::stackThirds(table->scale, d, 4));
+				if (mode == DiatonicMode::Major) {
+					//names as triad() and seventh() give them
+					table->triads.back()->name = "";
+					table->sevenths.back()->name = "7";
+				}
+			}
+			//analyse up front so threads sharing the table only ever read
+			for (std::shared_ptr<Chord> c : table->triads) {
+				c->updateAnalysis();
+			}
+			for (std::shared_ptr<Chord> c : table->sevenths) {
+				c->updateAnalysis();
+			}
+			return table;
+		}
+
+		//count notes in thirds from scale[degree], wrapping into the next octave
+		static std::shared_ptr<Chord> stackThirds(const std::vector<NotePtr>& scale, int degree, int count) {
+			std::shared_ptr<Chord> chord = Chord::create();
+			chord->notes.clear();
+			chord->setRoot(scale[degree]);
+			for (int k = 0; k < count; k++) {
+				int i = degree + 2 * k;
+				NotePtr n = scale[i % scale.size()];
+				if (i >= (int)scale.size()) {
+					n = n->copy();
+					n->changeOctave(1);
+				}
+				chord->notes.push_back(n);
+			}
+			chord->name = Chord::getDiatonicShorthand(chord->getIntervalSignature());
+			return chord;
+		}
+
+		static std::string getDiatonicShorthand(int sig) {
+			typedef ChordSignature S;
+			switch (sig) {
+				case S::ROOT | S::MAJOR_THIRD | S::FIFTH: return "M";
+				case S::ROOT | S::MINOR_THIRD | S::FIFTH: return "m";
+				case S::ROOT | S::MINOR_THIRD | S::TRITONE: return "dim";
+				case S::ROOT | S::MAJOR_THIRD | S::MINOR_SIXTH: return "aug";
+				case S::ROOT | S::MAJOR_THIRD | S::FIFTH | S::MAJOR_SEVENTH: return "M7";
+				case S::ROOT | S::MAJOR_THIRD | S::FIFTH | S::MINOR_SEVENTH: return "7";
+				case S::ROOT | S::MINOR_THIRD | S::FIFTH | S::MINOR_SEVENTH: return "m7";
+				case S::ROOT | S::MINOR_THIRD | S::FIFTH | S::MAJOR_SEVENTH: return "mM7";
+				case S::ROOT | S::MINOR_THIRD | S::TRITONE | S::MINOR_SEVENTH: return "m7b5";
+				case S::ROOT | S::MINOR_THIRD | S::TRITONE | S::MAJOR_SIXTH: return "dim7";
+				case S::ROOT | S::MAJOR_THIRD | S::MINOR_SIXTH | S::MAJOR_SEVENTH: return "M7+";
+				default: return "";
+			}
+		}
+
+		//replaces notes[i] with a copy moved by octaves, other chords may share the original
+		void shiftNote(int i, int octaves) {
+			NotePtr n = notes[i]->copy();
+			n->changeOctave(octaves);
+			notes[i] = n;
+		}
+
+		static const int CACHED_NOTES = 16;//bigger chords are simply re-analysed on every query
+		int cachedPitches[CACHED_NOTES] = {};
+		int cachedSize = -1;
+		int cachedRootPitch = 0;
+		int cachedBassPitch = 0;
+		int cachedRootOffset = 0;
+		int cachedSignature = 0;
+
 		//give access to private parts
 		friend std::ostream& operator<<(std::ostream& os, const Chord& n);
 		friend std::ostream& operator<<(std::ostream& os, const std::shared_ptr<Chord>& n);
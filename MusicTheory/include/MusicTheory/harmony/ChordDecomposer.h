@@ -0,0 +1,404 @@
+/*
+ *  ChordDecomposer.h
+ *  MusicTheory
+ *
+ *  Names a set of notes as one chord, a slash chord, or two or more
+ *  chords stacked as a polychord, eg. an upper structure triad over a
+ *  dominant. Works on pitch classes only, so the order and octaves of the
+ *  notes do not matter except for which one is lowest.
+ *
+ *  {{{
+ *  >>> ChordDecomposer::decompose({C3, E3, G3, Bb3, D4, F#4, A4})[0].name
+ *  "D|C7"
+ *  >>> ChordDecomposer::decompose({C3, D4, F#4, A4})[0].name
+ *  "D/C"
+ *  }}}
+ *
+ *  Every chord of the vocabulary on every root inside the set is a part.
+ *  Covers of the set are built by dynamic programming over subsets of its
+ *  pitch classes, at most 4096, keeping the cheapest few for each subset.
+ *  The search is bounded by that and by maxParts, not by the number or
+ *  order of the notes as Chord::determinePolychords is.
+ *
+ */
+
+#ifndef _ChordDecomposer
+#define _ChordDecomposer
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Chord.h"
+
+namespace MusicTheory{
+
+	enum class DecompositionType {
+		Chord,			//eg. C7
+		Slash,			//a chord over another bass, or inverted, eg. D/C, C/E
+		Polychord,		//top|bottom, eg. Eb|C
+		UpperStructure	//a triad over a dominant, eg. D|C7
+	};
+
+
+	struct ChordPart {
+		int root = 0;		//pitch class, C = 0
+		int symbol = -1;	//Chord::getSymbolId
+		int pitchClasses = 0;	//12 bit set of what it covers
+	};
+
+
+	struct ChordDecomposition {
+		DecompositionType type = DecompositionType::Chord;
+		std::vector<ChordPart> parts;	//top first, the bottom one last
+		int bass = -1;					//pitch class of the lowest note
+		float cost = 0;					//lower is better
+		std::string name;				//eg. "D|C7", "C/E"
+	};
+
+
+	struct ChordDecomposerSettings {
+		int maxParts = 2;				//most chords stacked, at most 3
+		int maxResults = 10;
+		int minPartSize = 3;			//smallest chord used as a part, 3 leaves out power chords
+		float partCost = 1.0;			//per chord used
+		float noteCost = 0.1;			//per note of a part beyond three, simpler chords first
+		float overlapCost = 0.25;		//per pitch class two parts share
+		float inversionCost = 0.5;		//bottom chord not on the bass
+		float foreignBassCost = 0.5;	//bass outside the chord above it, eg. D/C
+		float upperStructureBonus = 0.5;	//major or minor triad over a dominant
+	};
+
+
+
+class ChordDecomposer {
+
+  public:
+
+	/*
+	 Ranked names of notes, cheapest first. Notes are named as spelled in
+	 the input.
+	 */
+	static std::vector<ChordDecomposition> decompose(const std::deque<NotePtr>& notes, ChordDecomposerSettings settings = ChordDecomposerSettings()) {
+		int pitchClasses = 0;
+		int bass = -1;
+		int lowest = 0;
+		std::vector<std::string> spelling(12);
+		for (const NotePtr& n : notes) {
+			if (!n || !n->name.size()) {
+				continue;
+			}
+			int pc = ((n->toInt(true) % 12) + 12) % 12;
+			if (!spelling[pc].size()) {
+				spelling[pc] = n->name;
+			}
+			pitchClasses |= 1 << pc;
+			if (bass < 0 || n->toInt() < lowest) {
+				lowest = n->toInt();
+				bass = pc;
+			}
+		}
+		return ChordDecomposer::decompose(pitchClasses, bass, settings, spelling);
+	}
+
+	/*
+	 Same from a 12 bit pitch class set and the bass pitch class. Notes
+	 missing from spelling are named with flats.
+	 */
+	static std::vector<ChordDecomposition> decompose(int pitchClasses, int bass, ChordDecomposerSettings settings = ChordDecomposerSettings(), std::vector<std::string> spelling = std::vector<std::string>()) {
+		std::vector<ChordDecomposition> result;
+		pitchClasses &= 0xFFF;
+		if (bass < 0 || bass > 11 || !(pitchClasses & (1 << bass))) {
+			return result;
+		}
+		static const char* flats[12] = { "C", "Db", "D", "Eb", "E", "F", "Gb", "G", "Ab", "A", "Bb", "B" };
+		spelling.resize(12);
+		for (int pc = 0; pc < 12; pc++) {
+			if (!spelling[pc].size()) {
+				spelling[pc] = flats[pc];
+			}
+		}
+		settings.maxParts = std::max(1, std::min(settings.maxParts, 3));
+		settings.maxResults = std::max(1, settings.maxResults);
+
+		std::vector<Candidate> candidates = ChordDecomposer::getCandidates(pitchClasses, settings);
+		std::vector<std::vector<Cover>> covers = ChordDecomposer::cover(candidates, pitchClasses, bass, settings);
+
+		//the whole set, bass in the bottom chord
+		for (const Cover& c : covers[pitchClasses]) {
+			result.push_back(ChordDecomposer::makeDecomposition(c, candidates, bass, false, settings, spelling));
+		}
+		//a single chord over a bass of its own
+		int upper = pitchClasses & ~(1 << bass);
+		for (int i = 0; i < (int)candidates.size(); i++) {
+			if (candidates[i].part.pitchClasses == upper) {
+				Cover c;
+				c.parts[0] = i;
+				c.count = 1;
+				c.cost = candidates[i].cost;
+				result.push_back(ChordDecomposer::makeDecomposition(c, candidates, bass, true, settings, spelling));
+			}
+		}
+
+		std::sort(result.begin(), result.end(), [](const ChordDecomposition& a, const ChordDecomposition& b) {
+			return a.cost != b.cost ? a.cost < b.cost : a.name < b.name;
+		});
+		result.erase(std::unique(result.begin(), result.end(), [](const ChordDecomposition& a, const ChordDecomposition& b) { return a.name == b.name; }), result.end());
+		if ((int)result.size() > settings.maxResults) {
+			result.resize(settings.maxResults);
+		}
+		return result;
+	}
+
+
+	/*
+	 Interval signatures of the vocabulary, one symbol each, the shortest
+	 ChordLookup name where several spell the same notes, eg. "7" for dom7.
+	 */
+	static const std::vector<std::pair<int, int>>& getTemplates() {
+		static const std::vector<std::pair<int, int>> templates = []() {
+			const ChordVocabulary& v = Chord::getVocabulary();
+			std::vector<std::pair<int, int>> t;//signature, symbol
+			for (int id = 0; id < (int)v.symbols.size(); id++) {
+				int sig = v.signatures[id];
+				auto same = std::find_if(t.begin(), t.end(), [sig](const std::pair<int, int>& p) { return p.first == sig; });
+				if (same == t.end()) {
+					t.push_back(std::make_pair(sig, id));
+				}
+				else if (ChordDecomposer::isPreferred(v, id, same->second)) {
+					same->second = id;
+				}
+			}
+			return t;
+		}();
+		return templates;
+	}
+
+
+  private:
+
+	struct Candidate {
+		ChordPart part;
+		int size = 0;
+		float cost = 0;
+	};
+
+	//parts in candidate order, so each set of parts is found once
+	struct Cover {
+		int parts[3] = { -1, -1, -1 };
+		int count = 0;
+		float cost = 0;		//of the parts and their overlaps
+		float rank = 0;		//what keep orders by, the final cost for covers of the whole set
+	};
+
+
+	static bool isPreferred(const ChordVocabulary& v, int id, int current) {
+		if (v.named[id] != v.named[current]) {
+			return v.named[id];
+		}
+		return v.symbols[id].size() < v.symbols[current].size();
+	}
+
+	static int rotate(int signature, int root) {
+		return ((signature << root) | (signature >> (12 - root))) & 0xFFF;
+	}
+
+	static int bitCount(int x) {
+		int n = 0;
+		for (; x; x &= x - 1) {
+			n++;
+		}
+		return n;
+	}
+
+
+	//every template on every root that fits inside the set
+	static std::vector<Candidate> getCandidates(int pitchClasses, const ChordDecomposerSettings& settings) {
+		std::vector<Candidate> candidates;
+		for (const std::pair<int, int>& t : ChordDecomposer::getTemplates()) {
+			int size = ChordDecomposer::bitCount(t.first);
+			if (size < settings.minPartSize) {
+				continue;
+			}
+			for (int root = 0; root < 12; root++) {
+				if (!(pitchClasses & (1 << root))) {
+					continue;
+				}
+				int mask = ChordDecomposer::rotate(t.first, root);
+				if (mask & ~pitchClasses) {
+					continue;
+				}
+				Candidate c;
+				c.part.root = root;
+				c.part.symbol = t.second;
+				c.part.pitchClasses = mask;
+				c.size = size;
+				c.cost = settings.partCost + settings.noteCost * (size - 3);
+				candidates.push_back(c);
+			}
+		}
+		return candidates;
+	}
+
+
+	/*
+	 covers[m] holds the cheapest ways, up to maxResults, to make exactly
+	 the pitch classes m out of up to maxParts candidates. Built a part at
+	 a time: a cover of k parts is a cover of k - 1 parts plus one
+	 candidate with a higher index, where no part is contained in the
+	 others. Covers of the whole set are kept by their final cost, bass
+	 and upper structure included, so pruning matches the ranking.
+	 */
+	static std::vector<std::vector<Cover>> cover(const std::vector<Candidate>& candidates, int pitchClasses, int bass, const ChordDecomposerSettings& settings) {
+		std::vector<std::vector<Cover>> covers(1 << 12);
+		std::vector<int> masks;//subsets with a cover of the previous size
+		for (int i = 0; i < (int)candidates.size(); i++) {
+			Cover c;
+			c.parts[0] = i;
+			c.count = 1;
+			c.cost = candidates[i].cost;
+			int m = candidates[i].part.pitchClasses;
+			c.rank = m == pitchClasses ? ChordDecomposer::arrange(c, candidates, bass, false, settings).cost : c.cost;
+			if (!covers[m].size()) {
+				masks.push_back(m);
+			}
+			ChordDecomposer::keep(covers[m], c, settings.maxResults);
+		}
+		for (int k = 2; k <= settings.maxParts; k++) {
+			std::vector<int> next;
+			for (int m : masks) {
+				std::vector<Cover> from = covers[m];//copy, covers[m] may grow below
+				for (const Cover& c : from) {
+					if (c.count != k - 1) {
+						continue;
+					}
+					for (int i = c.parts[k - 2] + 1; i < (int)candidates.size(); i++) {
+						int add = candidates[i].part.pitchClasses;
+						Cover n = c;
+						n.parts[k - 1] = i;
+						n.count = k;
+						if (ChordDecomposer::isRedundant(n, candidates)) {
+							continue;
+						}
+						n.cost = c.cost + candidates[i].cost + settings.overlapCost * ChordDecomposer::bitCount(add & m);
+						int u = m | add;
+						n.rank = u == pitchClasses ? ChordDecomposer::arrange(n, candidates, bass, false, settings).cost : n.cost;
+						if (!covers[u].size()) {
+							next.push_back(u);
+						}
+						ChordDecomposer::keep(covers[u], n, settings.maxResults);
+					}
+				}
+			}
+			masks.insert(masks.end(), next.begin(), next.end());
+			std::sort(masks.begin(), masks.end());
+			masks.erase(std::unique(masks.begin(), masks.end()), masks.end());
+		}
+		return covers;
+	}
+
+	//true when a part adds nothing to the others, eg. D with D7
+	static bool isRedundant(const Cover& c, const std::vector<Candidate>& candidates) {
+		for (int i = 0; i < c.count; i++) {
+			int others = 0;
+			for (int j = 0; j < c.count; j++) {
+				if (j != i) {
+					others |= candidates[c.parts[j]].part.pitchClasses;
+				}
+			}
+			if (!(candidates[c.parts[i]].part.pitchClasses & ~others)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//inserts by rank, drops the worst past limit
+	static void keep(std::vector<Cover>& list, const Cover& c, int limit) {
+		if ((int)list.size() >= limit && c.rank >= list.back().rank) {
+			return;
+		}
+		auto at = std::upper_bound(list.begin(), list.end(), c, [](const Cover& a, const Cover& b) { return a.rank < b.rank; });
+		list.insert(at, c);
+		if ((int)list.size() > limit) {
+			list.pop_back();
+		}
+	}
+
+
+	/*
+	 Parts top first with the bottom chord last, the type, and the cost
+	 with the bass and upper structure adjustments. Everything but the name.
+	 */
+	static ChordDecomposition arrange(const Cover& c, const std::vector<Candidate>& candidates, int bass, bool foreignBass, const ChordDecomposerSettings& settings) {
+		ChordDecomposition d;
+		d.bass = bass;
+		d.cost = c.cost;
+		for (int i = 0; i < c.count; i++) {
+			d.parts.push_back(candidates[c.parts[i]].part);
+		}
+
+		//bottom: a part on the bass, else any part holding it
+		int bottom = -1;
+		for (int i = 0; i < (int)d.parts.size(); i++) {
+			if (d.parts[i].root == bass) {
+				bottom = i;
+				break;
+			}
+			if (bottom < 0 && (d.parts[i].pitchClasses & (1 << bass))) {
+				bottom = i;
+			}
+		}
+		if (bottom < 0) {
+			bottom = 0;
+		}
+		std::swap(d.parts[bottom], d.parts.back());
+		std::sort(d.parts.begin(), d.parts.end() - 1, [](const ChordPart& a, const ChordPart& b) {
+			return a.root != b.root ? a.root < b.root : a.symbol < b.symbol;
+		});
+		const ChordPart& low = d.parts.back();
+
+		if (foreignBass) {
+			d.cost += settings.foreignBassCost;
+		}
+		else if (low.root != bass) {
+			d.cost += settings.inversionCost;
+		}
+
+		if (d.parts.size() == 1) {
+			d.type = (foreignBass || low.root != bass) ? DecompositionType::Slash : DecompositionType::Chord;
+		}
+		else {
+			int topSignature = ChordDecomposer::rotate(d.parts[0].pitchClasses, (12 - d.parts[0].root) % 12);
+			int lowSignature = ChordDecomposer::rotate(low.pitchClasses, (12 - low.root) % 12);
+			bool triad = ChordDecomposer::bitCount(topSignature) == 3 && (topSignature & ChordSignature::FIFTH) && (ChordSignature::isMajor(topSignature) || ChordSignature::isMinor(topSignature));
+			bool upperStructure = d.parts.size() == 2 && triad && ChordSignature::isDominant(lowSignature);
+			d.type = upperStructure ? DecompositionType::UpperStructure : DecompositionType::Polychord;
+			if (upperStructure) {
+				d.cost -= settings.upperStructureBonus;
+			}
+		}
+		return d;
+	}
+
+	static ChordDecomposition makeDecomposition(const Cover& c, const std::vector<Candidate>& candidates, int bass, bool foreignBass, const ChordDecomposerSettings& settings, const std::vector<std::string>& spelling) {
+		ChordDecomposition d = ChordDecomposer::arrange(c, candidates, bass, foreignBass, settings);
+		const ChordPart& low = d.parts.back();
+		for (int i = 0; i < (int)d.parts.size(); i++) {
+			if (i) {
+				d.name += "|";
+			}
+			d.name += spelling[d.parts[i].root] + Chord::getSymbol(d.parts[i].symbol);
+		}
+		if (foreignBass || low.root != bass) {
+			d.name += "/" + spelling[bass];
+		}
+		return d;
+	}
+
+};//class
+
+}//namespace
+
+#endif
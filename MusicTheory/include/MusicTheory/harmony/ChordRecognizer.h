@@ -0,0 +1,391 @@
+/*
+ *  ChordRecognizer.h
+ *  MusicTheory
+ *
+ *  Chords from audio. Chroma frames (see Chromagram) are scored against
+ *  pitch class templates of ChordLookup symbols on all 12 roots, then
+ *  smoothed with a Viterbi pass. Transition probabilities come from root
+ *  motion and chord quality statistics of roman numeral progressions,
+ *  parsed with Progression, so V7 -> I is likely and a random jump is not.
+ *
+ *  {{{
+ *  ChordRecognizer recognizer;
+ *  std::vector<ChordSegment> chords = recognizer.recognize(samples, size, 44100);
+ *  chords[0].name -> "Am7"
+ *  Chord::fromShorthand(chords[0].name)
+ *  }}}
+ *
+ *  Templates and transitions are built once in the constructor. After that
+ *  a recognizer is read only and can be shared by threads, recognizeAll
+ *  does that for a batch of files.
+ *
+ */
+
+#ifndef _ChordRecognizer
+#define _ChordRecognizer
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <future>
+#include <thread>
+
+#include "Chord.h"
+#include "Chromagram.h"
+#include "Progression.h"
+
+namespace MusicTheory{
+
+	struct ChordRecognizerSettings {
+		//ChordLookup symbols used as templates, on every root. Empty = every symbol in ChordLookup
+		std::vector<std::string> symbols = { "M", "m", "7", "M7", "m7", "dim", "dim7", "m7b5", "aug", "sus4", "sus2" };
+		//roman progressions the transition statistics are counted from, empty = ChordRecognizer::getDefaultProgressions()
+		std::vector<std::string> progressions;
+		float selfTransition = 0.9;		//probability of staying on the same chord from one frame to the next
+		float noChordTransition = 0.02;	//probability of moving into the no chord state
+		float sharpness = 20;			//emission log score per unit of template similarity
+		float noChordSimilarity = 0.7;	//similarity the no chord state gets on a sounding frame
+		int harmonics = 4;				//partials per chord tone in the templates, 1 for plain chord tones
+		float harmonicDecay = 0.6;		//weight of partial h is harmonicDecay^(h-1)
+		float smoothing = 0.5;			//added to every transition count
+		int threads = 0;				//for recognizeAll, 0 = std::thread::hardware_concurrency()
+		ChromagramSettings chroma;
+	};
+
+
+	struct ChordSegment {
+		double start = 0;			//seconds
+		double end = 0;
+		std::string name;			//eg. "C#m7", "N" for no chord. Chord::fromShorthand(name) builds it
+		int root = -1;				//pitch class, -1 for no chord
+		std::string symbol;			//ChordLookup symbol, eg. "m7"
+		float score = 0;			//mean template similarity over the segment, 0-1
+	};
+
+
+
+class ChordRecognizer {
+
+  public:
+
+	ChordRecognizer(ChordRecognizerSettings _settings = ChordRecognizerSettings()) {
+		settings = _settings;
+		buildTemplates();
+		buildTransitions();
+	}
+
+
+	/*
+	 Whole signal in, chord segments out.
+	 */
+	std::vector<ChordSegment> recognize(const float* samples, long long size, float sampleRate) const {
+		ChromagramSettings cs = settings.chroma;
+		cs.sampleRate = sampleRate;
+		Chromagram chromagram(cs);
+		std::vector<Chroma> frames = chromagram.compute(samples, size);
+		return recognize(frames, chromagram.getSettings().hopSize / (double)sampleRate);
+	}
+
+	/*
+	 Chroma frames in, hopSeconds apart.
+	 */
+	std::vector<ChordSegment> recognize(const std::vector<Chroma>& frames, double hopSeconds) const {
+		std::vector<int> path = viterbi(frames);
+		std::vector<ChordSegment> segments;
+		for (int t = 0; t < (int)path.size();) {
+			int s = path[t];
+			int u = t;
+			float score = 0;
+			while (u < (int)path.size() && path[u] == s) {
+				score += similarity(frames[u], s);
+				u++;
+			}
+			ChordSegment seg;
+			seg.start = t * hopSeconds;
+			seg.end = u * hopSeconds;
+			seg.root = states[s].root;
+			seg.symbol = states[s].symbol;
+			seg.name = states[s].name;
+			seg.score = score / (u - t);
+			segments.push_back(seg);
+			t = u;
+		}
+		return segments;
+	}
+
+	/*
+	 Many signals at once, one worker per chunk of signals.
+	 */
+	std::vector<std::vector<ChordSegment>> recognizeAll(const std::vector<std::vector<float>>& signals, float sampleRate) const {
+		std::vector<std::vector<ChordSegment>> result(signals.size());
+		int threads = settings.threads > 0 ? settings.threads : std::max(1, (int)std::thread::hardware_concurrency());
+		int workers = std::min(threads, (int)signals.size());
+		if (workers <= 1) {
+			for (int i = 0; i < (int)signals.size(); i++) {
+				result[i] = recognize(signals[i].data(), signals[i].size(), sampleRate);
+			}
+			return result;
+		}
+		//files differ in length, so workers pull the next one instead of taking fixed chunks
+		std::atomic<int> next(0);
+		std::vector<std::future<void>> jobs;
+		for (int w = 0; w < workers; w++) {
+			jobs.push_back(std::async(std::launch::async, [&]() {
+				for (int i = next++; i < (int)signals.size(); i = next++) {
+					result[i] = recognize(signals[i].data(), signals[i].size(), sampleRate);
+				}
+			}));
+		}
+		for (int j = 0; j < (int)jobs.size(); j++) {
+			jobs[j].get();
+		}
+		return result;
+	}
+
+
+	/*
+	 Progressions counted when the settings give none. Pop, jazz and
+	 minor key staples, in roman numerals relative to the key.
+	 */
+	static std::vector<std::string> getDefaultProgressions() {
+		return {
+			"I,IV,V,I", "I,V,VIm,IV", "I,VIm,IV,V", "VIm,IV,I,V", "I,IV,I,V",
+			"I,VIm,IIm,V", "I,IIIm,IV,V", "IV,V,IIIm,VIm", "I,bVII,IV,I", "I,V,IV,I",
+			"IIm7,V7,IM7", "IIm7,V7,IM7,VIm7", "IM7,VIm7,IIm7,V7", "IIIm7,VIm7,IIm7,V7", "IVM7,V7,IIIm7,VIm7",
+			"I7,IV7,I7,V7,IV7,I7", "I,II7,V7,I", "I,VI7,IIm7,V7", "IIm7b5,V7,Im7", "Im7,IVm7,bVIIM7,bIIIM7",
+			"Im,IVm,V7,Im", "Im,bVI,bVII,Im", "Im,bVII,bVI,V7", "Im,bIII,bVII,IV", "Im,IVm,bVII,bIII",
+			"Isus4,I,IV,V", "I,Vsus4,V,I", "I,VIIdim,I", "IV,IVm,I", "I,Idim7,IIm7,V7"
+		};
+	}
+
+	int getStateCount() const {
+		return (int)states.size();
+	}
+
+	//template similarity of a frame to every state, in state order
+	std::vector<float> getSimilarities(const Chroma& c) const {
+		std::vector<float> out(states.size());
+		for (int s = 0; s < (int)states.size(); s++) {
+			out[s] = similarity(c, s);
+		}
+		return out;
+	}
+
+
+  private:
+
+	struct State {
+		int root = -1;
+		std::string symbol;
+		std::string name;
+		int quality = -1;//index into qualities
+		Chroma weights;//unit length template, unused for no chord
+	};
+
+	ChordRecognizerSettings settings;
+	std::vector<State> states;				//states[0] is no chord
+	std::vector<int> qualities;				//interval signature per quality
+	std::vector<float> transitions;			//log, states x states
+
+
+	void buildTemplates() {
+		std::vector<std::string> symbols = settings.symbols;
+		if (symbols.empty()) {
+			for (auto it = ChordLookup.begin(); it != ChordLookup.end(); it++) {
+				symbols.push_back(it->first);
+			}
+		}
+
+		State none;
+		none.name = "N";
+		none.weights.fill(0.0f);
+		states.push_back(none);
+
+		std::vector<std::string> roots = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+		for (std::string symbol : symbols) {
+			if (!ChordLookup.count(symbol)) {
+				continue;
+			}
+			ChordPtr chord = Chord::chordFromShorthand(symbol, Note::create("C"));
+			if (!chord || !chord->isValid()) {
+				continue;
+			}
+			int signature = chord->getIntervalSignature();
+			//symbols sharing a sound, eg. "M" and "", become one quality
+			if (std::find(qualities.begin(), qualities.end(), signature) != qualities.end()) {
+				continue;
+			}
+			qualities.push_back(signature);
+			for (int r = 0; r < 12; r++) {
+				State s;
+				s.root = r;
+				s.symbol = symbol;
+				s.name = roots[r] + symbol;
+				s.quality = (int)qualities.size() - 1;
+				s.weights.fill(0.0f);
+				for (int i = 0; i < 12; i++) {
+					if (!(signature & (1 << i))) {
+						continue;
+					}
+					//overtones land on the octave and fifth, so a bare triad does not look like its seventh chord
+					float w = 1.0f;
+					for (int h = 1; h <= settings.harmonics; h++) {
+						int offset = (int)std::lround(12 * std::log2((double)h));
+						s.weights[(r + i + offset) % 12] += w;
+						w *= settings.harmonicDecay;
+					}
+				}
+				Chromagram::normalize(s.weights);
+				states.push_back(s);
+			}
+		}
+	}
+
+
+	/*
+	 Counts (quality, root motion, quality) over the progressions in every
+	 key at once, since they are counted relative to the chord roots.
+	 */
+	void buildTransitions() {
+		int q = (int)qualities.size();
+		std::vector<float> counts(q * 12 * q, settings.smoothing);
+
+		std::vector<std::string> progressions = settings.progressions.size() ? settings.progressions : ChordRecognizer::getDefaultProgressions();
+		NotePtr key = Note::create("C");
+		for (std::string progression : progressions) {
+			std::deque<ChordPtr> chords = Progression::fromString(progression, key);
+			int previousRoot = -1, previousQuality = -1;
+			for (ChordPtr chord : chords) {
+				if (!chord || !chord->isValid()) {
+					previousRoot = -1;
+					continue;
+				}
+				int root = Voicing::pitchClass(chord->getBassPitch() + chord->getRootOffset());
+				int quality = nearestQuality(chord->getIntervalSignature());
+				if (previousRoot >= 0) {
+					int motion = ((root - previousRoot) % 12 + 12) % 12;
+					counts[(previousQuality * 12 + motion) * q + quality] += 1;
+				}
+				previousRoot = root;
+				previousQuality = quality;
+			}
+		}
+
+		int n = (int)states.size();
+		transitions.assign(n * n, 0.0f);
+		float self = settings.selfTransition;
+		float toNone = settings.noChordTransition;
+		for (int a = 0; a < n; a++) {
+			if (a == 0) {
+				//out of no chord any chord is as likely
+				for (int b = 0; b < n; b++) {
+					transitions[b] = std::log(b == 0 ? self : (1 - self) / (n - 1));
+				}
+				continue;
+			}
+			float total = 0;
+			for (int b = 1; b < n; b++) {
+				if (b != a) {
+					total += transitionCount(counts, a, b);
+				}
+			}
+			for (int b = 0; b < n; b++) {
+				float p;
+				if (b == a) {
+					p = self;
+				}
+				else if (b == 0) {
+					p = toNone;
+				}
+				else {
+					p = (1 - self - toNone) * transitionCount(counts, a, b) / total;
+				}
+				transitions[a * n + b] = std::log(std::max(p, 1e-12f));
+			}
+		}
+	}
+
+	float transitionCount(const std::vector<float>& counts, int a, int b) const {
+		int q = (int)qualities.size();
+		int motion = ((states[b].root - states[a].root) % 12 + 12) % 12;
+		return counts[(states[a].quality * 12 + motion) * q + states[b].quality];
+	}
+
+	//quality whose signature differs in the fewest intervals
+	int nearestQuality(int signature) const {
+		int best = 0, bestDistance = 99;
+		for (int i = 0; i < (int)qualities.size(); i++) {
+			int x = qualities[i] ^ signature;
+			int d = 0;
+			for (; x; x &= x - 1) {
+				d++;
+			}
+			if (d < bestDistance) {
+				bestDistance = d;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+
+	//cosine similarity, silence only matches no chord
+	float similarity(const Chroma& c, int s) const {
+		float dot = 0, energy = 0;
+		for (int i = 0; i < 12; i++) {
+			dot += c[i] * states[s].weights[i];
+			energy += c[i];
+		}
+		if (energy <= 0) {
+			return s == 0 ? 1.0f : 0.0f;
+		}
+		return s == 0 ? settings.noChordSimilarity : dot;
+	}
+
+
+	std::vector<int> viterbi(const std::vector<Chroma>& frames) const {
+		int n = (int)states.size();
+		int T = (int)frames.size();
+		std::vector<int> path(T);
+		if (T == 0 || n == 0) {
+			return path;
+		}
+		std::vector<float> score(n), next(n), emission(n);
+		std::vector<int> back((size_t)T * n);
+
+		for (int s = 0; s < n; s++) {
+			score[s] = settings.sharpness * similarity(frames[0], s);
+		}
+		for (int t = 1; t < T; t++) {
+			for (int s = 0; s < n; s++) {
+				emission[s] = settings.sharpness * similarity(frames[t], s);
+			}
+			for (int b = 0; b < n; b++) {
+				float best = -1e30f;
+				int arg = 0;
+				for (int a = 0; a < n; a++) {
+					float v = score[a] + transitions[a * n + b];
+					if (v > best) {
+						best = v;
+						arg = a;
+					}
+				}
+				next[b] = best + emission[b];
+				back[(size_t)t * n + b] = arg;
+			}
+			score.swap(next);
+		}
+		int s = (int)(std::max_element(score.begin(), score.end()) - score.begin());
+		for (int t = T - 1; t >= 0; t--) {
+			path[t] = s;
+			s = back[(size_t)t * n + s];
+		}
+		return path;
+	}
+
+};//class
+
+}//namespace
+
+#endif
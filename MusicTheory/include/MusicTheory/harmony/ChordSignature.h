@@ -0,0 +1,211 @@
+/*
+ *  ChordSignature.h
+ *  MusicTheory
+ *
+ *  Chord quality from a 12 bit interval signature, see Chord::getIntervalSignature().
+ *  Bit n is set when the chord holds a pitch n semitones above its root.
+ *  Everything here is bit tests on an int, nothing allocates.
+ *
+ */
+
+#ifndef _ChordSignature
+#define _ChordSignature
+
+namespace MusicTheory{
+
+	enum class ChordFamily {
+		Unknown,
+		Major,			//major third, no minor seventh
+		Minor,			//minor third
+		Dominant,		//major third and minor seventh
+		Diminished,		//minor third and diminished fifth, eg. dim, dim7
+		HalfDiminished,	//diminished triad with minor seventh, eg. m7b5
+		Augmented,		//major third and augmented fifth
+		Suspended,		//fourth or second instead of a third
+		Power			//root and fifth only
+	};
+
+
+	/*
+	 Result of ChordSignature::classify.
+	 {{{
+	 >>> ChordSignature::classify(Chord::create("C7#9")->getIntervalSignature())
+	 family Dominant, extensions SEVENTH, alterations SHARP_NINTH
+	 }}}
+	 */
+	struct ChordQuality {
+		ChordFamily family = ChordFamily::Unknown;
+		int extensions = 0;		//ChordSignature::SIXTH ... THIRTEENTH
+		int alterations = 0;	//ChordSignature::FLAT_FIFTH ... FLAT_THIRTEENTH
+
+		bool has(int flag) const {
+			return ((extensions | alterations) & flag) != 0;
+		}
+	};
+
+
+
+class ChordSignature {
+
+  public:
+
+	//interval bits
+	static const int ROOT = 1 << 0;
+	static const int MINOR_SECOND = 1 << 1;
+	static const int MAJOR_SECOND = 1 << 2;
+	static const int MINOR_THIRD = 1 << 3;
+	static const int MAJOR_THIRD = 1 << 4;
+	static const int FOURTH = 1 << 5;
+	static const int TRITONE = 1 << 6;
+	static const int FIFTH = 1 << 7;
+	static const int MINOR_SIXTH = 1 << 8;
+	static const int MAJOR_SIXTH = 1 << 9;
+	static const int MINOR_SEVENTH = 1 << 10;
+	static const int MAJOR_SEVENTH = 1 << 11;
+
+	//extensions
+	static const int SIXTH = 1 << 0;
+	static const int SEVENTH = 1 << 1;
+	static const int NINTH = 1 << 2;
+	static const int ELEVENTH = 1 << 3;
+	static const int THIRTEENTH = 1 << 4;
+
+	//alterations
+	static const int FLAT_FIFTH = 1 << 8;
+	static const int SHARP_FIFTH = 1 << 9;
+	static const int FLAT_NINTH = 1 << 10;
+	static const int SHARP_NINTH = 1 << 11;
+	static const int SHARP_ELEVENTH = 1 << 12;
+	static const int FLAT_THIRTEENTH = 1 << 13;
+
+
+	/*
+	 Note: isDominant will report true for isMajor as well. Best to check that first.
+	 */
+	static constexpr bool isMajor(int sig) {
+		return (sig & MAJOR_THIRD) != 0;
+	}
+
+	static constexpr bool isMinor(int sig) {
+		return (sig & MINOR_THIRD) && !(sig & MAJOR_THIRD);
+	}
+
+	static constexpr bool isDominant(int sig) {
+		return (sig & MAJOR_THIRD) && (sig & MINOR_SEVENTH);
+	}
+
+	/*
+	 Note: This is true for minor as well.
+	 */
+	static constexpr bool isDiminished(int sig) {
+		return isMinor(sig) && (sig & TRITONE) && !(sig & FIFTH);
+	}
+
+	/*
+	 Fourth in place of the third, eg. sus4, sus47, 11.
+	 sus2 is reported by classify() as ChordFamily::Suspended but not here.
+	 */
+	static constexpr bool isSuspended(int sig) {
+		return (sig & FOURTH) && !(sig & (MINOR_THIRD | MAJOR_THIRD));
+	}
+
+
+	static constexpr ChordFamily getFamily(int sig) {
+		bool major = sig & MAJOR_THIRD;
+		bool minor = (sig & MINOR_THIRD) && !major;
+		bool flatFive = (sig & TRITONE) && !(sig & FIFTH);
+		bool sharpFive = (sig & MINOR_SIXTH) && !(sig & FIFTH);
+
+		if (major) {
+			if (sharpFive && !(sig & MINOR_SEVENTH)) {
+				return ChordFamily::Augmented;
+			}
+			return (sig & MINOR_SEVENTH) ? ChordFamily::Dominant : ChordFamily::Major;
+		}
+		if (minor) {
+			if (flatFive) {
+				return (sig & MINOR_SEVENTH) ? ChordFamily::HalfDiminished : ChordFamily::Diminished;
+			}
+			return ChordFamily::Minor;
+		}
+		if (sig & (FOURTH | MAJOR_SECOND)) {
+			return ChordFamily::Suspended;
+		}
+		if ((sig & ~ROOT) == FIFTH) {
+			return ChordFamily::Power;
+		}
+		return ChordFamily::Unknown;
+	}
+
+
+	/*
+	 Family plus extensions and altered tones.
+	 Ninths, elevenths and thirteenths only count as extensions when there
+	 is a third; in sus2/sus4 chords those bits are the suspension.
+	 */
+	static constexpr ChordQuality classify(int sig) {
+		ChordQuality q;
+		q.family = getFamily(sig);
+
+		bool third = sig & (MINOR_THIRD | MAJOR_THIRD);
+		bool diminishedSeventh = q.family == ChordFamily::Diminished && (sig & MAJOR_SIXTH) && !(sig & (MINOR_SEVENTH | MAJOR_SEVENTH));
+		bool seventh = (sig & (MINOR_SEVENTH | MAJOR_SEVENTH)) || diminishedSeventh;
+
+		if (seventh) {
+			q.extensions |= SEVENTH;
+		}
+		if ((sig & MAJOR_SIXTH) && !diminishedSeventh) {
+			q.extensions |= seventh ? THIRTEENTH : SIXTH;
+		}
+		if (third && (sig & MAJOR_SECOND)) {
+			q.extensions |= NINTH;
+		}
+		if (third && (sig & FOURTH)) {
+			q.extensions |= ELEVENTH;
+		}
+
+		if (sig & MINOR_SECOND) {
+			q.alterations |= FLAT_NINTH;
+		}
+		if ((sig & MINOR_THIRD) && (sig & MAJOR_THIRD)) {
+			q.alterations |= SHARP_NINTH;
+		}
+		if (sig & TRITONE) {
+			if (sig & FIFTH) {
+				q.alterations |= SHARP_ELEVENTH;
+			}
+			else if (q.family != ChordFamily::Diminished && q.family != ChordFamily::HalfDiminished) {
+				q.alterations |= FLAT_FIFTH;
+			}
+		}
+		if (sig & MINOR_SIXTH) {
+			if (sig & FIFTH) {
+				q.alterations |= FLAT_THIRTEENTH;
+			}
+			else if (q.family != ChordFamily::Augmented) {
+				q.alterations |= SHARP_FIFTH;
+			}
+		}
+		return q;
+	}
+
+
+	static const char* getFamilyName(ChordFamily family) {
+		switch (family) {
+			case ChordFamily::Major: return "major";
+			case ChordFamily::Minor: return "minor";
+			case ChordFamily::Dominant: return "dominant";
+			case ChordFamily::Diminished: return "diminished";
+			case ChordFamily::HalfDiminished: return "half diminished";
+			case ChordFamily::Augmented: return "augmented";
+			case ChordFamily::Suspended: return "suspended";
+			case ChordFamily::Power: return "power";
+			default: return "unknown";
+		}
+	}
+
+};//class
+
+}//namespace
+
+#endif
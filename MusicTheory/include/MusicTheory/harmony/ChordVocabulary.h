@@ -0,0 +1,148 @@
+/*
+ *  ChordVocabulary.h
+ *  MusicTheory
+ *
+ *  Every chord symbol Chord knows, indexed by what it contains. Each
+ *  category, family, quality flag and interval has a ChordSet with one
+ *  bit per symbol, so a query is a few ands and ors of bitsets.
+ *  Chord::getVocabulary() builds it once, on C, and shares it.
+ *
+ *  {{{
+ *  const ChordVocabulary& v = Chord::getVocabulary();
+ *  //flat nine, no third
+ *  ChordSet found = v.withIntervals(ChordSignature::MINOR_SECOND) & v.withoutIntervals(ChordSignature::MINOR_THIRD | ChordSignature::MAJOR_THIRD);
+ *  v.getSymbols(found) -> ["sus4b9", "susb9"]
+ *  }}}
+ *
+ *  Bit i of a ChordSet is the symbol with Chord::getSymbolId i.
+ *
+ */
+
+#ifndef _ChordVocabulary
+#define _ChordVocabulary
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include "ChordSignature.h"
+
+namespace MusicTheory{
+
+	typedef std::bitset<128> ChordSet;
+
+
+	struct ChordVocabulary {
+		static const int CAPACITY = 128;
+		static const int FAMILIES = 9;		//ChordFamily values
+		static const int QUALITIES = 14;	//bit numbers of the ChordQuality flags
+
+		std::vector<std::string> symbols;	//by symbol id
+		std::vector<int> signatures;		//interval signature of each, see Chord::getIntervalSignature
+
+		ChordSet all;
+		ChordSet named;				//in ChordLookup, eg. "M" but not "Maj7"
+		ChordSet major;				//as Chord::isMajor and so on
+		ChordSet minor;
+		ChordSet dominant;
+		ChordSet diminished;
+		ChordSet suspended;
+		ChordSet intervals[12];		//holds the pitch n semitones above the root
+		ChordSet families[FAMILIES];
+		ChordSet qualities[QUALITIES];
+
+		/*
+		 Indexes a symbol. Symbols must be added in id order.
+		 */
+		void add(const std::string& symbol, int signature, bool isNamed) {
+			int id = (int)symbols.size();
+			if (id >= CAPACITY) {
+				return;
+			}
+			symbols.push_back(symbol);
+			signatures.push_back(signature);
+			all.set(id);
+			named[id] = isNamed;
+			major[id] = ChordSignature::isMajor(signature);
+			minor[id] = ChordSignature::isMinor(signature);
+			dominant[id] = ChordSignature::isDominant(signature);
+			diminished[id] = ChordSignature::isDiminished(signature);
+			suspended[id] = ChordSignature::isSuspended(signature);
+			for (int i = 0; i < 12; i++) {
+				intervals[i][id] = (signature >> i) & 1;
+			}
+			ChordQuality quality = ChordSignature::classify(signature);
+			families[(int)quality.family].set(id);
+			int flags = quality.extensions | quality.alterations;
+			for (int i = 0; i < QUALITIES; i++) {
+				qualities[i][id] = (flags >> i) & 1;
+			}
+		}
+
+
+		/*
+		 Symbols holding every interval in mask, ChordSignature interval bits.
+		 */
+		ChordSet withIntervals(int mask) const {
+			ChordSet s = all;
+			for (int i = 0; i < 12; i++) {
+				if (mask & (1 << i)) {
+					s &= intervals[i];
+				}
+			}
+			return s;
+		}
+
+		/*
+		 Symbols holding none of the intervals in mask.
+		 */
+		ChordSet withoutIntervals(int mask) const {
+			ChordSet s;
+			for (int i = 0; i < 12; i++) {
+				if (mask & (1 << i)) {
+					s |= intervals[i];
+				}
+			}
+			return all & ~s;
+		}
+
+		/*
+		 Symbols with every ChordQuality flag in flags, eg.
+		 ChordSignature::NINTH | ChordSignature::SHARP_ELEVENTH.
+		 */
+		ChordSet withQuality(int flags) const {
+			ChordSet s = all;
+			for (int i = 0; i < QUALITIES; i++) {
+				if (flags & (1 << i)) {
+					s &= qualities[i];
+				}
+			}
+			return s;
+		}
+
+		ChordSet inFamily(ChordFamily family) const {
+			return families[(int)family];
+		}
+
+
+		//symbols in the set, in id order, which is sorted
+		std::vector<std::string> getSymbols(const ChordSet& s) const {
+			std::vector<std::string> result;
+			result.reserve(s.count());
+			for (int id = 0; id < (int)symbols.size(); id++) {
+				if (s[id]) {
+					result.push_back(symbols[id]);
+				}
+			}
+			return result;
+		}
+
+		//-1 if the symbol is not in the vocabulary
+		int getSignature(int id) const {
+			return (id >= 0 && id < (int)signatures.size()) ? signatures[id] : -1;
+		}
+	};
+
+}//namespace
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ *  Chromagram.h
+ *  MusicTheory
+ *
+ *  12 bin chroma vectors from audio, one per hop. Each FFT bin in the
+ *  analysed range is assigned to the pitch class of its nearest note
+ *  once, in the constructor, so a frame is one FFT and one pass over
+ *  the bins.
+ *
+ *  {{{
+ *  Chromagram chroma;
+ *  std::vector<Chroma> frames;
+ *  chroma.process(block, 512, frames);
+ *  }}}
+ *
+ */
+
+#ifndef _Chromagram
+#define _Chromagram
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "FFT.h"
+#include "Tuning.h"
+
+namespace MusicTheory{
+
+	//energy per pitch class, C = 0. Unit length, or all zeros for silence
+	typedef std::array<float, 12> Chroma;
+
+
+	struct ChromagramSettings {
+		float sampleRate = 44100;
+		int frameSize = 4096;		//rounded up to a power of two
+		int hopSize = 2048;
+		float minFrequency = 100;	//below this the bins are wider than a semitone
+		float maxFrequency = 2000;
+		float silence = 1e-4;		//frames with lower rms give an all zero chroma
+		float compression = 10;		//log(1 + compression * amplitude), 0 for plain amplitudes
+	};
+
+
+
+class Chromagram {
+
+  public:
+
+	Chromagram(ChromagramSettings _settings = ChromagramSettings(), const Tuning& tuning = Tuning()) : fft(_settings.frameSize) {
+		settings = _settings;
+		settings.frameSize = fft.getSize();
+		settings.hopSize = std::max(1, std::min(settings.hopSize, settings.frameSize));
+		window = FFT::hann(settings.frameSize);
+		buffer.assign(settings.frameSize, 0.0f);
+		magnitudes.assign(settings.frameSize / 2 + 1, 0.0f);
+
+		//bin -> pitch class, -1 outside the range
+		binClass.assign(settings.frameSize / 2 + 1, -1);
+		for (int k = 1; k <= settings.frameSize / 2; k++) {
+			double hz = k * (double)settings.sampleRate / settings.frameSize;
+			if (hz < settings.minFrequency || hz > settings.maxFrequency) {
+				continue;
+			}
+			PitchEstimate e = tuning.fromHertz(hz);
+			if (e.pitch >= 0) {
+				binClass[k] = e.pitch % 12;
+			}
+		}
+		reset();
+	}
+
+	void reset() {
+		filled = 0;
+		frames = 0;
+	}
+
+
+	/*
+	 Consumes count samples and appends a Chroma per completed frame.
+	 Returns the number of frames added.
+	 */
+	int process(const float* samples, int count, std::vector<Chroma>& out) {
+		int added = 0;
+		while (count > 0) {
+			int n = std::min(count, settings.frameSize - filled);
+			std::memcpy(buffer.data() + filled, samples, n * sizeof(float));
+			filled += n;
+			samples += n;
+			count -= n;
+			if (filled == settings.frameSize) {
+				out.push_back(analyse(buffer.data()));
+				added++;
+				frames++;
+				std::memmove(buffer.data(), buffer.data() + settings.hopSize, (settings.frameSize - settings.hopSize) * sizeof(float));
+				filled -= settings.hopSize;
+			}
+		}
+		return added;
+	}
+
+	/*
+	 Chroma of a whole signal.
+	 */
+	std::vector<Chroma> compute(const float* samples, long long size) {
+		std::vector<Chroma> out;
+		out.reserve((size_t)(size / settings.hopSize + 1));
+		reset();
+		const int block = 1 << 16;
+		for (long long i = 0; i < size; i += block) {
+			process(samples + i, (int)std::min<long long>(block, size - i), out);
+		}
+		return out;
+	}
+
+	/*
+	 Chroma of one frame of frameSize samples.
+	 */
+	Chroma analyse(const float* frame) {
+		Chroma c;
+		c.fill(0.0f);
+		float energy = 0;
+		for (int i = 0; i < settings.frameSize; i++) {
+			energy += frame[i] * frame[i];
+		}
+		if (std::sqrt(energy / settings.frameSize) < settings.silence) {
+			return c;
+		}
+		fft.getMagnitudes(frame, window.data(), magnitudes.data());
+		//to sine amplitudes, so compression does not depend on the frame size
+		float scale = 4.0f / settings.frameSize;
+		for (int k = 0; k < (int)binClass.size(); k++) {
+			int pc = binClass[k];
+			if (pc >= 0) {
+				float m = magnitudes[k] * scale;
+				c[pc] += settings.compression > 0 ? std::log1p(settings.compression * m) : m;
+			}
+		}
+		Chromagram::normalize(c);
+		return c;
+	}
+
+
+	//seconds from the first sample to the start of frame i
+	double getTime(int frame) const {
+		return frame * (double)settings.hopSize / settings.sampleRate;
+	}
+
+	const ChromagramSettings& getSettings() const {
+		return settings;
+	}
+
+	static void normalize(Chroma& c) {
+		float sum = 0;
+		for (float v : c) {
+			sum += v * v;
+		}
+		if (sum > 0) {
+			float scale = 1.0f / std::sqrt(sum);
+			for (float& v : c) {
+				v *= scale;
+			}
+		}
+	}
+
+
+  private:
+
+	ChromagramSettings settings;
+	FFT fft;
+	std::vector<float> window;
+	std::vector<float> buffer;
+	std::vector<float> magnitudes;
+	std::vector<int> binClass;
+	int filled;
+	int frames;
+
+};//class
+
+}//namespace
+
+#endif
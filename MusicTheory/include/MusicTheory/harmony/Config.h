@@ -0,0 +1,59 @@
+/*
+ *  Config.h
+ *  MusicTheory
+ *
+ *  Header only or compiled core.
+ *
+ *  By default every table (ChordLookup, ChordScaleLookup, _keyCache ...)
+ *  is inline: one instance per program, however many files include the
+ *  headers. The lookup maps are LazyTables, built on first use instead of
+ *  before main, so programs only pay for the tables they touch.
+ *
+ *  Define MUSICTHEORY_COMPILED_LIB and link the MusicTheory library to
+ *  have the tables and their builders defined once in src/MusicTheory.cpp
+ *  instead. The headers then only declare them, so no other object file
+ *  carries their initialisers.
+ *
+ */
+
+#ifndef _MusicTheoryConfig
+#define _MusicTheoryConfig
+
+#include <cstddef>
+
+#ifdef MUSICTHEORY_COMPILED_LIB
+	#define MUSICTHEORY_INLINE
+	#ifndef MUSICTHEORY_CORE_SOURCE	//defined by src/MusicTheory.cpp only
+		#define MUSICTHEORY_TABLES_EXTERN
+	#endif
+#else
+	#define MUSICTHEORY_HEADER_ONLY
+	#define MUSICTHEORY_INLINE inline
+#endif
+
+namespace MusicTheory{
+
+	/*
+	 A map built by build() the first time it is used, in a function local
+	 static so that is thread safe. Holds nothing itself, so declaring one
+	 costs nothing at startup, and it reads like the map it stands for.
+	 >>> ChordLookup.find("m7")
+	 */
+	template <class Table, Table (*build)()>
+	struct LazyTable {
+		Table& get() const {
+			static Table table = build();
+			return table;
+		}
+		operator Table&() const { return get(); }
+		typename Table::iterator begin() const { return get().begin(); }
+		typename Table::iterator end() const { return get().end(); }
+		typename Table::iterator find(const typename Table::key_type& key) const { return get().find(key); }
+		size_t count(const typename Table::key_type& key) const { return get().count(key); }
+		size_t size() const { return get().size(); }
+		typename Table::mapped_type& operator[](const typename Table::key_type& key) const { return get()[key]; }
+	};
+
+}//namespace
+
+#endif
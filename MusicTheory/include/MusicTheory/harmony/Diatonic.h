@@ -21,14 +21,19 @@
 
 #include <iostream>
 
+#include "Config.h"
 #include "Note.h"
 
 
 
 namespace MusicTheory{
     
-    static const std::string fifths = "F,C,G,D,A,E,B";
-    static std::map<std::string, std::deque<NotePtr> > _keyCache;
+    inline constexpr char fifths[] = "F,C,G,D,A,E,B";
+#ifdef MUSICTHEORY_TABLES_EXTERN
+    extern std::map<std::string, std::deque<NotePtr> > _keyCache;
+#else
+    MUSICTHEORY_INLINE std::map<std::string, std::deque<NotePtr> > _keyCache;
+#endif
     
 class Diatonic {
 	
@@ -70,9 +75,11 @@ class Diatonic {
      This function will raise an !NoteFormatError if the key isn't recognised
      */
     static std::deque<NotePtr> getNotes(NotePtr key){
+        MUSICTHEORY_TIME(InstrumentTimer::DiatonicGetNotes);
         //check cache
  
         if (_keyCache[key->name+std::to_string(key->octave)].size()>0){
+            MUSICTHEORY_COUNT(InstrumentCounter::KeyCacheHit);
         
             //since now shared ptrs need to return copies, else modifies map on use
             
@@ -86,6 +93,8 @@ class Diatonic {
         
         
         
+        MUSICTHEORY_COUNT(InstrumentCounter::KeyCacheMiss);
+
         //root note
         std::string root = key->name.substr(0,1);
         
@@ -183,18 +192,20 @@ class Diatonic {
         }
 #endif // LOGS
 
-        //Save original to cache and return a copy so cache won't be corrupted by
-        //modified pointers
-        
-        _keyCache[key->name+std::to_string(key->getOctave())] = keySorted;
+        //Save a copy to cache so it won't be corrupted by modified pointers.
+        //The copy is made on the heap since the cache outlives any arena
+        //the caller may have installed (see Allocation.h)
         
-        
-        std::deque<NotePtr> copyDeque;
-        for(NotePtr n:keySorted){
-            copyDeque.push_back(n->copy());
+        std::deque<NotePtr> cached;
+        {
+            ScopedHeap heap;
+            for(NotePtr n:keySorted){
+                cached.push_back(n->copy());
+            }
         }
+        _keyCache[key->name+std::to_string(key->getOctave())] = cached;
             
-        return copyDeque;
+        return keySorted;
     }
     
     
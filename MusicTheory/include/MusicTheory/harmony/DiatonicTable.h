@@ -0,0 +1,135 @@
+/*
+ *  DiatonicTable.h
+ *  MusicTheory
+ *
+ *  Triads and sevenths on every degree of a key, built once per key and
+ *  mode and shared from then on, see Chord::getDiatonicTable().
+ *
+ *  The chords in a table are shared by every caller. Read them freely,
+ *  copy() before changing anything.
+ *
+ */
+
+#ifndef _DiatonicTable
+#define _DiatonicTable
+
+#include <memory>
+#include <vector>
+
+#include "Note.h"
+
+namespace MusicTheory{
+
+	class Chord;
+
+
+	enum class DiatonicMode {
+		Major,			//as Chord::triads and Chord::sevenths always did
+		Dorian,
+		Phrygian,
+		Lydian,
+		Mixolydian,
+		NaturalMinor,
+		Locrian,
+		HarmonicMinor,
+		MelodicMinor	//ascending form
+	};
+
+
+	struct DiatonicTable {
+		DiatonicMode mode = DiatonicMode::Major;
+		std::vector<NotePtr> scale;						//7 degrees from the key up
+		std::vector<std::shared_ptr<Chord>> triads;		//one per degree
+		std::vector<std::shared_ptr<Chord>> sevenths;	//one per degree
+	};
+
+	typedef std::shared_ptr<const DiatonicTable> DiatonicTablePtr;
+
+
+
+class DiatonicModes {
+
+  public:
+
+	/*
+	 Semitones above the key for each degree.
+	 >>> DiatonicModes::getSteps(DiatonicMode::HarmonicMinor)
+	 { 0, 2, 3, 5, 7, 8, 11 }
+	 */
+	static constexpr const int* getSteps(DiatonicMode mode) {
+		return STEPS[(int)mode];
+	}
+
+	//indexed by DiatonicMode
+	static constexpr int STEPS[9][7] = {
+		{ 0, 2, 4, 5, 7, 9, 11 },
+		{ 0, 2, 3, 5, 7, 9, 10 },
+		{ 0, 1, 3, 5, 7, 8, 10 },
+		{ 0, 2, 4, 6, 7, 9, 11 },
+		{ 0, 2, 4, 5, 7, 9, 10 },
+		{ 0, 2, 3, 5, 7, 8, 10 },
+		{ 0, 1, 3, 5, 6, 8, 10 },
+		{ 0, 2, 3, 5, 7, 8, 11 },
+		{ 0, 2, 3, 5, 7, 9, 11 }
+	};
+
+	static const char* getName(DiatonicMode mode) {
+		switch (mode) {
+			case DiatonicMode::Major: return "major";
+			case DiatonicMode::Dorian: return "dorian";
+			case DiatonicMode::Phrygian: return "phrygian";
+			case DiatonicMode::Lydian: return "lydian";
+			case DiatonicMode::Mixolydian: return "mixolydian";
+			case DiatonicMode::NaturalMinor: return "natural minor";
+			case DiatonicMode::Locrian: return "locrian";
+			case DiatonicMode::HarmonicMinor: return "harmonic minor";
+			case DiatonicMode::MelodicMinor: return "melodic minor";
+			default: return "unknown";
+		}
+	}
+
+	/*
+	 Scale on key with one letter per degree, so accidentals come out the
+	 way a key signature would write them.
+	 >>> DiatonicModes::getScale(Note::create("D"), DiatonicMode::HarmonicMinor)
+	 ["D", "E", "F", "G", "A", "Bb", "C#"]
+	 */
+	static std::vector<NotePtr> getScale(NotePtr key, DiatonicMode mode) {
+		static const char* letters = "CDEFGAB";
+		static const int naturals[7] = { 0, 2, 4, 5, 7, 9, 11 };
+		const int* steps = DiatonicModes::getSteps(mode);
+
+		std::vector<NotePtr> scale;
+		int letter = 0;
+		while (letter < 7 && letters[letter] != toupper(key->name[0])) {
+			letter++;
+		}
+		if (letter == 7) {
+			return scale;
+		}
+		int keyPitch = key->toInt();
+		int keyClass = ((keyPitch % 12) + 12) % 12;
+
+		for (int d = 0; d < 7; d++) {
+			int l = (letter + d) % 7;
+			int target = (keyClass + steps[d]) % 12;
+			int accidentals = ((target - naturals[l]) % 12 + 12) % 12;
+			if (accidentals > 6) {
+				accidentals -= 12;
+			}
+			std::string name(1, letters[l]);
+			name += std::string(std::abs(accidentals), accidentals > 0 ? '#' : 'b');
+
+			NotePtr n = Note::create(name, key->getOctave());
+			int diff = keyPitch + steps[d] - n->toInt();
+			n->changeOctave(diff / 12);
+			scale.push_back(n);
+		}
+		return scale;
+	}
+
+};//class
+
+}//namespace
+
+#endif
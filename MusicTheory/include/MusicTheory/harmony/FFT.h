@@ -0,0 +1,131 @@
+/*
+ *  FFT.h
+ *  MusicTheory
+ *
+ *  Small radix-2 FFT for the audio analysis classes. Twiddles and the bit
+ *  reversal are computed once per size, the transform itself allocates
+ *  nothing. One FFT object per thread, it keeps its scratch buffers.
+ *
+ */
+
+#ifndef _FFT
+#define _FFT
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace MusicTheory{
+
+class FFT {
+
+  public:
+
+	/*
+	 size is rounded up to a power of two.
+	 */
+	FFT(int _size = 4096) {
+		size = 1;
+		bits = 0;
+		while (size < _size) {
+			size <<= 1;
+			bits++;
+		}
+		reversed.resize(size);
+		for (int i = 0; i < size; i++) {
+			int r = 0;
+			for (int b = 0; b < bits; b++) {
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			}
+			reversed[i] = r;
+		}
+		cosines.resize(size / 2);
+		sines.resize(size / 2);
+		for (int i = 0; i < size / 2; i++) {
+			double angle = -2.0 * 3.14159265358979323846 * i / size;
+			cosines[i] = (float)std::cos(angle);
+			sines[i] = (float)std::sin(angle);
+		}
+		re.resize(size);
+		im.resize(size);
+	}
+
+	int getSize() const {
+		return size;
+	}
+
+
+	/*
+	 In place forward transform of size complex values.
+	 */
+	void forward(float* real, float* imag) const {
+		for (int i = 0; i < size; i++) {
+			int r = reversed[i];
+			if (r > i) {
+				std::swap(real[i], real[r]);
+				std::swap(imag[i], imag[r]);
+			}
+		}
+		for (int half = 1; half < size; half <<= 1) {
+			int step = size / (half * 2);
+			for (int start = 0; start < size; start += half * 2) {
+				for (int k = 0; k < half; k++) {
+					float wr = cosines[k * step];
+					float wi = sines[k * step];
+					int a = start + k;
+					int b = a + half;
+					float tr = real[b] * wr - imag[b] * wi;
+					float ti = real[b] * wi + imag[b] * wr;
+					real[b] = real[a] - tr;
+					imag[b] = imag[a] - ti;
+					real[a] += tr;
+					imag[a] += ti;
+				}
+			}
+		}
+	}
+
+
+	/*
+	 Magnitudes of a real signal, size / 2 + 1 values into out.
+	 window may be null, else it is multiplied in first.
+	 */
+	void getMagnitudes(const float* input, const float* window, float* out) {
+		for (int i = 0; i < size; i++) {
+			re[i] = window ? input[i] * window[i] : input[i];
+			im[i] = 0;
+		}
+		forward(re.data(), im.data());
+		for (int i = 0; i <= size / 2; i++) {
+			out[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+		}
+	}
+
+
+	/*
+	 Hann window of size samples.
+	 */
+	static std::vector<float> hann(int size) {
+		std::vector<float> w(size);
+		for (int i = 0; i < size; i++) {
+			w[i] = 0.5f - 0.5f * (float)std::cos(2.0 * 3.14159265358979323846 * i / (size - 1));
+		}
+		return w;
+	}
+
+
+  private:
+
+	int size;
+	int bits;
+	std::vector<int> reversed;
+	std::vector<float> cosines;
+	std::vector<float> sines;
+	std::vector<float> re;
+	std::vector<float> im;
+
+};//class
+
+}//namespace
+
+#endif
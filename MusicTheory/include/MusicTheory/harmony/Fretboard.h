@@ -0,0 +1,457 @@
+/*
+ *  Fretboard.h
+ *  MusicTheory
+ *
+ *  Chord fingerings on fretted instruments.
+ *
+ *  Fretboard::search lists every playable fingering of a chord for a
+ *  tuning, ranked by stretch, string skipping and distance from the
+ *  previous fingering. It is a depth first search from the lowest string
+ *  up over precomputed fret -> pitch class tables, cut as soon as the
+ *  hand span is exceeded or the remaining strings cannot complete the chord.
+ *
+ *  {{{
+ *  std::vector<Fingering> f = Fretboard::search(Chord::create("G7"), StringTuning::guitar());
+ *  f[0].toString() -> "320001"
+ *  }}}
+ *
+ */
+
+#ifndef _Fretboard
+#define _Fretboard
+
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "Chord.h"
+#include "Voicing.h"
+
+namespace MusicTheory{
+
+/*
+ Open string pitches from the lowest string up, midi numbers (C-3 = 60).
+ */
+	struct StringTuning {
+		std::vector<int> strings;
+
+		static StringTuning guitar() {
+			return { { 40, 45, 50, 55, 59, 64 } };		//EADGBE
+		}
+
+		static StringTuning dropD() {
+			return { { 38, 45, 50, 55, 59, 64 } };		//DADGBE
+		}
+
+		static StringTuning sevenString() {
+			return { { 35, 40, 45, 50, 55, 59, 64 } };	//BEADGBE
+		}
+
+		static StringTuning bass() {
+			return { { 28, 33, 38, 43 } };				//EADG
+		}
+
+		static StringTuning ukulele() {
+			return { { 67, 60, 64, 69 } };				//GCEA, re-entrant
+		}
+	};
+
+
+	struct FretboardSettings {
+		int fretSpan = 4;				//max distance between the lowest and highest fretted note, open strings excluded
+		int frets = 15;					//highest usable fret
+		int minStrings = 3;				//fewest sounding strings
+		int maxFingers = 4;				//fretting fingers, a barre across the lowest fret counts as one
+		int maxResults = 0;				//0 = all fingerings
+		int threads = 0;				//for searchAll, 0 = std::thread::hardware_concurrency()
+		bool bassInBass = true;			//lowest sounding note must be the chord's bass (keeps inversions and slash chords)
+		bool allowOmitFifth = true;		//a perfect fifth above the root may be left out
+		bool allowSkips = true;			//muted strings between sounding ones
+		float stretchWeight = 0.5;		//per fret between the lowest and highest fretted note
+		float skipWeight = 1.5;			//per muted string inside the fingering
+		float muteWeight = 0.5;			//per muted string, favours full chords
+		float omitWeight = 1.0;			//per chord tone left out
+		float positionWeight = 0.1;		//per fret up the neck, favours open position
+		float voiceLeadingWeight = 0.5;	//per semitone moved from the previous fingering
+	};
+
+
+/*
+ One fingering, fret per string from the lowest string, -1 = muted, 0 = open.
+ */
+	struct Fingering {
+		static const int MAX_STRINGS = 12;
+		static const int MUTED = -1;
+
+		int frets[MAX_STRINGS];
+		int strings = 0;
+		int stretch = 0;
+		int skips = 0;
+		int muted = 0;
+		int omitted = 0;				//chord tones not sounding
+		int position = 0;				//lowest fretted fret
+		float cost = 0;
+
+		Fingering() {
+			std::fill(frets, frets + MAX_STRINGS, MUTED);
+		}
+
+		/*
+		 Sounding pitches, low to high.
+		 */
+		Voicing getVoicing(const StringTuning& tuning) const {
+			Voicing v;
+			for (int s = 0; s < strings; s++) {
+				if (frets[s] != MUTED) {
+					v.add(tuning.strings[s] + frets[s]);
+				}
+			}
+			v.sort();
+			return v;
+		}
+
+		/*
+		 Tab style, one character per string, x for muted.
+		 >>> "x32010"
+		 Frets above 9 are put in parentheses, eg. "x(10)(12)(12)(12)x"
+		 */
+		std::string toString() const {
+			std::string s;
+			for (int i = 0; i < strings; i++) {
+				if (frets[i] == MUTED) {
+					s += "x";
+				}
+				else if (frets[i] < 10) {
+					s += std::to_string(frets[i]);
+				}
+				else {
+					s += "(" + std::to_string(frets[i]) + ")";
+				}
+			}
+			return s;
+		}
+	};
+
+
+
+class Fretboard {
+
+  public:
+
+	/*
+	 All fingerings of chord, cheapest first. Pass the fingering used for
+	 the previous chord to rank by voice leading as well.
+	 */
+	static std::vector<Fingering> search(ChordPtr chord, const StringTuning& tuning, FretboardSettings settings = FretboardSettings(), const Fingering* previous = nullptr) {
+		if (!chord || !chord->isValid()) {
+			return std::vector<Fingering>();
+		}
+		Target t = Fretboard::getTarget(chord);
+		std::vector<Fingering> result = Fretboard::search(t, tuning, settings);
+		Fretboard::rank(result, settings, previous);
+		return result;
+	}
+
+	/*
+	 >>> Fretboard::search("Am7", StringTuning::guitar())
+	 */
+	static std::vector<Fingering> search(std::string shorthand, const StringTuning& tuning, FretboardSettings settings = FretboardSettings(), const Fingering* previous = nullptr) {
+		return Fretboard::search(Chord::fromShorthand(shorthand), tuning, settings, previous);
+	}
+
+
+	/*
+	 Fingerings for a whole chord sequence, eg. a lead sheet.
+	 Chords are searched in parallel, then each list is ranked against
+	 the best fingering of the chord before it.
+	 */
+	static std::vector<std::vector<Fingering>> searchAll(const std::vector<ChordPtr>& chords, const StringTuning& tuning, FretboardSettings settings = FretboardSettings()) {
+		//chords cache their analysis on first use, read them on this thread only
+		std::vector<Target> targets(chords.size());
+		for (int c = 0; c < (int)chords.size(); c++) {
+			if (chords[c] && chords[c]->isValid()) {
+				targets[c] = Fretboard::getTarget(chords[c]);
+			}
+		}
+
+		std::vector<std::vector<Fingering>> result(chords.size());
+		int threads = settings.threads > 0 ? settings.threads : std::max(1, (int)std::thread::hardware_concurrency());
+		int workers = std::min(threads, (int)targets.size());
+		if (workers <= 1) {
+			for (int c = 0; c < (int)targets.size(); c++) {
+				result[c] = Fretboard::search(targets[c], tuning, settings);
+			}
+		}
+		else {
+			std::vector<std::future<void>> jobs;
+			int chunk = ((int)targets.size() + workers - 1) / workers;
+			for (int first = 0; first < (int)targets.size(); first += chunk) {
+				int last = std::min((int)targets.size(), first + chunk);
+				jobs.push_back(std::async(std::launch::async, [&, first, last]() {
+					for (int c = first; c < last; c++) {
+						result[c] = Fretboard::search(targets[c], tuning, settings);
+					}
+				}));
+			}
+			for (int j = 0; j < (int)jobs.size(); j++) {
+				jobs[j].get();
+			}
+		}
+
+		//voice leading depends on the previous choice, so this part is serial
+		for (int c = 0; c < (int)result.size(); c++) {
+			const Fingering* previous = c > 0 && !result[c - 1].empty() ? &result[c - 1][0] : nullptr;
+			Fretboard::rank(result[c], settings, previous);
+		}
+		return result;
+	}
+
+
+	/*
+	 Semitones moved between two fingerings, string by string.
+	 A string that starts or stops sounding counts as 2.
+	 */
+	static int getDistance(const Fingering& a, const Fingering& b) {
+		int d = 0;
+		int strings = std::min(a.strings, b.strings);
+		for (int s = 0; s < strings; s++) {
+			bool sa = a.frets[s] != Fingering::MUTED;
+			bool sb = b.frets[s] != Fingering::MUTED;
+			if (sa && sb) {
+				d += std::abs(a.frets[s] - b.frets[s]);
+			}
+			else if (sa != sb) {
+				d += 2;
+			}
+		}
+		return d;
+	}
+
+
+  private:
+
+	//what the search needs from a chord, plain data so it can cross threads
+	struct Target {
+		int mask = 0;		//pitch classes of the chord
+		int required = 0;	//pitch classes that must sound
+		int bass = -1;		//pitch class of the lowest note, -1 = any
+	};
+
+
+	static Target getTarget(ChordPtr chord) {
+		Target t;
+		t.mask = chord->getVoicing().getPitchClassMask();
+		t.required = t.mask;
+		t.bass = Voicing::pitchClass(chord->getBassPitch());
+		int root = Voicing::pitchClass(chord->getBassPitch() + chord->getRootOffset());
+		int fifth = 1 << ((root + 7) % 12);
+		//only a perfect fifth can go, and not when it is the bass
+		if ((t.mask & fifth) && t.bass != (root + 7) % 12) {
+			t.required &= ~fifth;
+		}
+		return t;
+	}
+
+
+	struct State {
+		const StringTuning* tuning;
+		const FretboardSettings* settings;
+		int strings;
+		int mask;
+		int required;
+		int bass;
+		//usable frets per string, precomputed
+		std::vector<int> options[Fingering::MAX_STRINGS];
+		Fingering current;
+		std::vector<Fingering>* out;
+	};
+
+
+	static std::vector<Fingering> search(const Target& target, const StringTuning& tuning, const FretboardSettings& settings) {
+		std::vector<Fingering> out;
+		int strings = std::min((int)tuning.strings.size(), (int)Fingering::MAX_STRINGS);
+		if (target.mask == 0 || strings == 0) {
+			return out;
+		}
+
+		State st;
+		st.tuning = &tuning;
+		st.settings = &settings;
+		st.strings = strings;
+		st.mask = target.mask;
+		st.required = settings.allowOmitFifth ? target.required : target.mask;
+		st.bass = settings.bassInBass ? target.bass : -1;
+		st.out = &out;
+		st.current.strings = strings;
+
+		//fret -> pitch class tables, keeping only frets that sound a chord tone
+		for (int s = 0; s < strings; s++) {
+			for (int f = 0; f <= settings.frets; f++) {
+				if (target.mask & (1 << Voicing::pitchClass(tuning.strings[s] + f))) {
+					st.options[s].push_back(f);
+				}
+			}
+		}
+
+		Fretboard::dfs(st, 0, 0, 0, 99, -1, -1, 0);
+		return out;
+	}
+
+
+	/*
+	 covered: pitch classes sounding so far
+	 sounding: number of sounding strings
+	 lo, hi: lowest and highest fretted fret so far
+	 lowestPitch: pitch of the lowest sounding note so far, -1 if none
+	 */
+	static void dfs(State& st, int s, int covered, int sounding, int lo, int hi, int lowestPitch, int skips) {
+		const FretboardSettings& settings = *st.settings;
+		int remaining = st.strings - s;
+
+		//not enough strings left to complete the chord
+		int missing = st.required & ~covered;
+		if (Fretboard::bitCount(missing) > remaining || sounding + remaining < settings.minStrings) {
+			return;
+		}
+
+		if (s == st.strings) {
+			Fretboard::emit(st, covered, lo, hi, skips);
+			return;
+		}
+
+		//mute this string
+		st.current.frets[s] = Fingering::MUTED;
+		Fretboard::dfs(st, s + 1, covered, sounding, lo, hi, lowestPitch, skips);
+
+		for (int f : st.options[s]) {
+			int nlo = lo, nhi = hi;
+			if (f > 0) {
+				nlo = std::min(lo, f);
+				nhi = std::max(hi, f);
+				if (nhi - nlo + 1 > settings.fretSpan) {
+					continue;
+				}
+			}
+			int pitch = st.tuning->strings[s] + f;
+			int pc = Voicing::pitchClass(pitch);
+			//the first sounding string sets the bass unless the tuning is re-entrant
+			int nlowest = lowestPitch < 0 ? pitch : std::min(lowestPitch, pitch);
+			if (st.bass >= 0 && !Fretboard::bassCanHold(st, s, nlowest)) {
+				continue;
+			}
+			//strings muted since the last sounding one
+			int nskips = skips;
+			if (sounding > 0) {
+				int gap = 0;
+				for (int p = s - 1; p >= 0 && st.current.frets[p] == Fingering::MUTED; p--) {
+					gap++;
+				}
+				if (gap > 0 && !settings.allowSkips) {
+					continue;
+				}
+				nskips += gap;
+			}
+			st.current.frets[s] = f;
+			Fretboard::dfs(st, s + 1, covered | (1 << pc), sounding + 1, nlo, nhi, nlowest, nskips);
+		}
+		st.current.frets[s] = Fingering::MUTED;
+	}
+
+	/*
+	 With bassInBass the lowest pitch must be the bass pitch class. On normal
+	 tunings strings only get higher, so this is decided at the first sounding
+	 string. On re-entrant tunings a lower string may still come, so only
+	 reject once no later string can go below.
+	 */
+	static bool bassCanHold(const State& st, int s, int lowest) {
+		if (Voicing::pitchClass(lowest) == st.bass) {
+			return true;
+		}
+		for (int r = s + 1; r < st.strings; r++) {
+			if (st.tuning->strings[r] < lowest) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void emit(State& st, int covered, int lo, int hi, int skips) {
+		Fingering f = st.current;
+		Voicing v = f.getVoicing(*st.tuning);
+		if (v.size < st.settings->minStrings) {
+			return;
+		}
+		if (st.bass >= 0 && Voicing::pitchClass(v.bass()) != st.bass) {
+			return;
+		}
+		if (Fretboard::getFingers(f, lo) > st.settings->maxFingers) {
+			return;
+		}
+		f.stretch = hi < 0 ? 0 : hi - lo;
+		f.position = hi < 0 ? 0 : lo;
+		f.skips = skips;
+		f.muted = st.strings - v.size;
+		f.omitted = Fretboard::bitCount(st.mask & ~covered);
+		st.out->push_back(f);
+	}
+
+
+	/*
+	 Fingers needed to fret f. The strings on the lowest fret take one
+	 finger when a barre can hold them, ie. no open string sounds between
+	 the first and the last of them.
+	 */
+	static int getFingers(const Fingering& f, int lo) {
+		int fretted = 0, first = -1, last = -1;
+		for (int s = 0; s < f.strings; s++) {
+			if (f.frets[s] > 0) {
+				fretted++;
+				if (f.frets[s] == lo) {
+					first = first < 0 ? s : first;
+					last = s;
+				}
+			}
+		}
+		if (first < 0) {
+			return fretted;
+		}
+		int onLowest = 0;
+		bool barre = true;
+		for (int s = first; s <= last; s++) {
+			onLowest += f.frets[s] == lo;
+			barre = barre && f.frets[s] != 0;
+		}
+		return barre ? fretted - onLowest + 1 : fretted;
+	}
+
+
+	static void rank(std::vector<Fingering>& fingerings, const FretboardSettings& settings, const Fingering* previous) {
+		for (Fingering& f : fingerings) {
+			f.cost = settings.stretchWeight * f.stretch
+				+ settings.skipWeight * f.skips
+				+ settings.muteWeight * f.muted
+				+ settings.omitWeight * f.omitted
+				+ settings.positionWeight * f.position;
+			if (previous) {
+				f.cost += settings.voiceLeadingWeight * Fretboard::getDistance(*previous, f);
+			}
+		}
+		std::stable_sort(fingerings.begin(), fingerings.end(), [](const Fingering& a, const Fingering& b) { return a.cost < b.cost; });
+		if (settings.maxResults > 0 && (int)fingerings.size() > settings.maxResults) {
+			fingerings.resize(settings.maxResults);
+		}
+	}
+
+	static int bitCount(int x) {
+		int c = 0;
+		for (; x; x &= x - 1) {
+			c++;
+		}
+		return c;
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ *  Instrumentation.h
+ *  MusicTheory
+ *
+ *  Opt in counters and timers on the library's hot paths: factory
+ *  allocations per type, key and diatonic table cache hits and misses,
+ *  regex compilations and time spent in the main analysis calls.
+ *
+ *  Build with MUSICTHEORY_INSTRUMENTATION defined to turn it on. Without
+ *  it the MUSICTHEORY_COUNT and MUSICTHEORY_TIME macros expand to nothing
+ *  and the library runs exactly as before.
+ *
+ *  {{{
+ *  Instrumentation::reset();
+ *  Progression::analyse("Dm7,G7,CM7", "C");
+ *  InstrumentationSnapshot used = Instrumentation::snapshot();
+ *  used.get(InstrumentCounter::RegexCompile) -> 11
+ *  std::cout << used.toJson();
+ *  }}}
+ *
+ *  Every thread counts into its own block, so counting is a plain add on
+ *  memory no other thread writes. snapshot() reads the calling thread,
+ *  snapshotAll() sums every thread, including ones that have finished.
+ *
+ */
+
+#ifndef _Instrumentation
+#define _Instrumentation
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace MusicTheory{
+
+	class Note;
+	class Chord;
+	class Scale;
+
+	enum class InstrumentCounter {
+		NoteAllocation,			//Note objects made through Allocation::make
+		ChordAllocation,
+		ScaleAllocation,
+		OtherAllocation,
+		KeyCacheHit,			//Diatonic::getNotes
+		KeyCacheMiss,
+		DiatonicTableHit,		//Chord::getDiatonicTable, behind triads(), sevenths() and the degree functions
+		DiatonicTableMiss,
+		RegexCompile,			//boost::regex built, eg. in Chord::isSlashChord
+		AnalysisCacheHit,		//Progression::getAnalysisCache
+		AnalysisCacheMiss,
+		Count
+	};
+
+	enum class InstrumentTimer {
+		DiatonicGetNotes,
+		ChordFromShorthand,
+		ChordDetermine,
+		ScalesForChord,
+		ProgressionDetermine,
+		Count
+	};
+
+
+	struct InstrumentationSnapshot {
+		static const int COUNTERS = (int)InstrumentCounter::Count;
+		static const int TIMERS = (int)InstrumentTimer::Count;
+
+		uint64_t counters[COUNTERS] = {};
+		uint64_t calls[TIMERS] = {};		//timed calls, nested ones included
+		uint64_t nanoseconds[TIMERS] = {};	//inclusive time
+
+		uint64_t get(InstrumentCounter c) const {
+			return counters[(int)c];
+		}
+
+		uint64_t getCalls(InstrumentTimer t) const {
+			return calls[(int)t];
+		}
+
+		double getSeconds(InstrumentTimer t) const {
+			return nanoseconds[(int)t] * 1e-9;
+		}
+
+		InstrumentationSnapshot operator-(const InstrumentationSnapshot& other) const {
+			InstrumentationSnapshot s;
+			for (int i = 0; i < COUNTERS; i++) {
+				s.counters[i] = counters[i] - other.counters[i];
+			}
+			for (int i = 0; i < TIMERS; i++) {
+				s.calls[i] = calls[i] - other.calls[i];
+				s.nanoseconds[i] = nanoseconds[i] - other.nanoseconds[i];
+			}
+			return s;
+		}
+
+		InstrumentationSnapshot& operator+=(const InstrumentationSnapshot& other) {
+			for (int i = 0; i < COUNTERS; i++) {
+				counters[i] += other.counters[i];
+			}
+			for (int i = 0; i < TIMERS; i++) {
+				calls[i] += other.calls[i];
+				nanoseconds[i] += other.nanoseconds[i];
+			}
+			return *this;
+		}
+
+		/*
+		 {"counters": {"NoteAllocation": 12, ...}, "timers": {"ChordDetermine": {"calls": 1, "ns": 5300}, ...}}
+		 */
+		std::string toJson() const {
+			std::ostringstream out;
+			out << "{\"counters\": {";
+			for (int i = 0; i < COUNTERS; i++) {
+				out << (i ? ", " : "") << "\"" << InstrumentationSnapshot::getName((InstrumentCounter)i) << "\": " << counters[i];
+			}
+			out << "}, \"timers\": {";
+			for (int i = 0; i < TIMERS; i++) {
+				out << (i ? ", " : "") << "\"" << InstrumentationSnapshot::getName((InstrumentTimer)i) << "\": {\"calls\": " << calls[i] << ", \"ns\": " << nanoseconds[i] << "}";
+			}
+			out << "}}";
+			return out.str();
+		}
+
+		static std::string getName(InstrumentCounter c) {
+			static const char* names[] = { "NoteAllocation", "ChordAllocation", "ScaleAllocation", "OtherAllocation", "KeyCacheHit", "KeyCacheMiss", "DiatonicTableHit", "DiatonicTableMiss", "RegexCompile", "AnalysisCacheHit", "AnalysisCacheMiss" };
+			return names[(int)c];
+		}
+
+		static std::string getName(InstrumentTimer t) {
+			static const char* names[] = { "DiatonicGetNotes", "ChordFromShorthand", "ChordDetermine", "ScalesForChord", "ProgressionDetermine" };
+			return names[(int)t];
+		}
+	};
+
+
+
+class Instrumentation {
+
+  public:
+
+	static constexpr bool isEnabled() {
+#ifdef MUSICTHEORY_INSTRUMENTATION
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static void count(InstrumentCounter c, uint64_t n = 1) {
+		std::atomic<uint64_t>& v = local().counters[(int)c];
+		//only this thread writes it, a load and store is enough and stays a plain add
+		v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	static void time(InstrumentTimer t, uint64_t nanoseconds) {
+		Block& b = local();
+		b.calls[(int)t].store(b.calls[(int)t].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		b.nanoseconds[(int)t].store(b.nanoseconds[(int)t].load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+	}
+
+	//allocation counter for the type Allocation::make is building
+	template <class T>
+	static constexpr InstrumentCounter getAllocationCounter() {
+		if constexpr (std::is_same<T, Note>::value) {
+			return InstrumentCounter::NoteAllocation;
+		}
+		else if constexpr (std::is_same<T, Chord>::value) {
+			return InstrumentCounter::ChordAllocation;
+		}
+		else if constexpr (std::is_same<T, Scale>::value) {
+			return InstrumentCounter::ScaleAllocation;
+		}
+		else {
+			return InstrumentCounter::OtherAllocation;
+		}
+	}
+
+
+	/*
+	 Counts on the calling thread since it started or last reset.
+	 */
+	static InstrumentationSnapshot snapshot() {
+		return local().read();
+	}
+
+	/*
+	 Counts summed over every thread. Threads still running may be a few
+	 counts ahead by the time this returns.
+	 */
+	static InstrumentationSnapshot snapshotAll() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		InstrumentationSnapshot s = r.finished;
+		for (Block* b : r.blocks) {
+			s += b->read();
+		}
+		return s;
+	}
+
+	static void reset() {
+		local().clear();
+	}
+
+	/*
+	 Resets every thread. Meant for between runs, counts made by other
+	 threads while it runs may survive it.
+	 */
+	static void resetAll() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> guard(r.lock);
+		r.finished = InstrumentationSnapshot();
+		for (Block* b : r.blocks) {
+			b->clear();
+		}
+	}
+
+	static std::string toJson() {
+		return Instrumentation::snapshotAll().toJson();
+	}
+
+
+  private:
+
+	struct Block {
+		std::atomic<uint64_t> counters[InstrumentationSnapshot::COUNTERS];
+		std::atomic<uint64_t> calls[InstrumentationSnapshot::TIMERS];
+		std::atomic<uint64_t> nanoseconds[InstrumentationSnapshot::TIMERS];
+
+		Block() {
+			clear();
+			Registry& r = registry();
+			std::lock_guard<std::mutex> guard(r.lock);
+			r.blocks.push_back(this);
+		}
+
+		//a finished thread's counts are kept in the registry
+		~Block() {
+			Registry& r = registry();
+			std::lock_guard<std::mutex> guard(r.lock);
+			r.finished += read();
+			for (int i = 0; i < (int)r.blocks.size(); i++) {
+				if (r.blocks[i] == this) {
+					r.blocks.erase(r.blocks.begin() + i);
+					break;
+				}
+			}
+		}
+
+		InstrumentationSnapshot read() const {
+			InstrumentationSnapshot s;
+			for (int i = 0; i < InstrumentationSnapshot::COUNTERS; i++) {
+				s.counters[i] = counters[i].load(std::memory_order_relaxed);
+			}
+			for (int i = 0; i < InstrumentationSnapshot::TIMERS; i++) {
+				s.calls[i] = calls[i].load(std::memory_order_relaxed);
+				s.nanoseconds[i] = nanoseconds[i].load(std::memory_order_relaxed);
+			}
+			return s;
+		}
+
+		void clear() {
+			for (auto& c : counters) {
+				c.store(0, std::memory_order_relaxed);
+			}
+			for (int i = 0; i < InstrumentationSnapshot::TIMERS; i++) {
+				calls[i].store(0, std::memory_order_relaxed);
+				nanoseconds[i].store(0, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	struct Registry {
+		std::mutex lock;
+		std::vector<Block*> blocks;
+		InstrumentationSnapshot finished;
+	};
+
+	static Registry& registry() {
+		//never destroyed, thread blocks can outlive static destruction
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	static Block& local() {
+		thread_local Block b;
+		return b;
+	}
+
+};//class
+
+
+
+/*
+ Adds the time from construction to destruction to a timer.
+ */
+class ScopedTimer {
+
+  public:
+
+	ScopedTimer(InstrumentTimer _timer) : timer(_timer), start(std::chrono::steady_clock::now()) {}
+
+	~ScopedTimer() {
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		Instrumentation::time(timer, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  private:
+
+	InstrumentTimer timer;
+	std::chrono::steady_clock::time_point start;
+
+};//class
+
+}//namespace
+
+
+#ifdef MUSICTHEORY_INSTRUMENTATION
+#define MUSICTHEORY_COUNT(counter) MusicTheory::Instrumentation::count(counter)
+#define MUSICTHEORY_TIME_JOIN(a, b) a##b
+#define MUSICTHEORY_TIME_NAME(line) MUSICTHEORY_TIME_JOIN(_musicTheoryTimer, line)
+#define MUSICTHEORY_TIME(timer) MusicTheory::ScopedTimer MUSICTHEORY_TIME_NAME(__LINE__)(timer)
+#else
+#define MUSICTHEORY_COUNT(counter) ((void)0)
+#define MUSICTHEORY_TIME(timer) ((void)0)
+#endif
+
+#endif
@@ -18,8 +18,10 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
 
+#include "Config.h"
 #include "Note.h"
 #include "Diatonic.h"
+#include "RomanNumeral.h"
 
 //class Note;
 namespace MusicTheory{
@@ -27,7 +29,7 @@ namespace MusicTheory{
     typedef NotePtr (*IntervalFunctionPointer)(NotePtr);
     typedef std::map<std::string,IntervalFunctionPointer> IntervalFuncLookup;
  
-    static std::vector<std::string>romanNumerals = {
+    inline constexpr const char* romanNumerals[] = {
             "I",
             "bII",
             "II",
@@ -585,35 +587,14 @@ class Interval {
     
     
     
+    /*
+     Semitones above the key for a roman numeral, eg. bIII = 3, #IV = 6.
+     Any chord suffix is ignored.
+     */
     static int fromRoman(std::string v){
-        boost::replace_all(v, " ", "");
-
-        boost::regex accEx{ "[#b]*(?=[iIvV])" };//find accidentals
-        boost::smatch match;
-        std::string acc;
-        if(boost::regex_search(v, match, accEx)) {
-            acc = v.substr(0,match.size());
-        }
-        
-        
-        int augs = utils::getNumberOfSharps(acc);
-        int dims = utils::getNumberOfFlats(acc);
-        int accidentals = utils::getNumberOfAccidentals(acc);
-        std::string roman = v.substr((augs+dims));//remove accidentals
-      
-
-        boost::regex romanEx{ "(?<!d)[iIvV]*" };//find all romans not prefixed by d, thus exclude i in dim..
-        
-        if(boost::regex_search(roman, match, romanEx)) {
-            roman = match[0].str();
-        }
-        
-        std::transform(roman.begin(), roman.end(), roman.begin(), ::toupper);
-
-        for(int i=0;i<romanNumerals.size();i++){
-            if(romanNumerals[i] == roman){
-                return i+accidentals;
-            }
+        RomanToken token = RomanNumeral::tokenize(v);
+        if(token.valid){
+            return token.semitones();
         }
 #ifdef LOGS
         ofLogError()<<"Roman "<<v<<" not found"<<std::endl;
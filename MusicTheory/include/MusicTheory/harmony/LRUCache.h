@@ -0,0 +1,163 @@
+/*
+ *  LRUCache.h
+ *  MusicTheory
+ *
+ *  Bounded least recently used cache that several threads can share.
+ *  Keys are spread over shards by hash, each shard with its own lock,
+ *  list and index, so threads only wait on each other when they touch
+ *  the same shard.
+ *
+ *  {{{
+ *  LRUCache<int, std::string> cache(1024);
+ *  cache.put(7, "V");
+ *  std::string v;
+ *  cache.get(7, v) -> true, v = "V"
+ *  }}}
+ *
+ *  Values are copied in and out, nothing handed out refers into the cache.
+ *
+ */
+
+#ifndef _LRUCache
+#define _LRUCache
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace MusicTheory{
+
+template <class Key, class Value, class Hash = std::hash<Key> >
+class LRUCache {
+
+  public:
+
+	/*
+	 capacity is the most entries kept over all shards, 0 keeps nothing.
+	 It is split between the shards, so below shardCount some keep nothing.
+	 */
+	LRUCache(size_t capacity = 4096, int shardCount = 16) {
+		shards.resize(std::max(1, shardCount));
+		for (auto& s : shards) {
+			s.reset(new Shard());
+		}
+		setCapacity(capacity);
+	}
+
+	LRUCache(const LRUCache&) = delete;
+	LRUCache& operator=(const LRUCache&) = delete;
+
+
+	/*
+	 Copies the value into out and marks it as the most recently used.
+	 */
+	bool get(const Key& key, Value& out) {
+		Shard& s = getShard(key);
+		std::lock_guard<std::mutex> guard(s.lock);
+		auto it = s.index.find(key);
+		if (it == s.index.end()) {
+			return false;
+		}
+		s.items.splice(s.items.begin(), s.items, it->second);
+		out = it->second->second;
+		return true;
+	}
+
+	/*
+	 Adds or replaces a value, dropping the least recently used entries of
+	 its shard when it is full.
+	 */
+	void put(const Key& key, const Value& value) {
+		Shard& s = getShard(key);
+		std::lock_guard<std::mutex> guard(s.lock);
+		if (s.capacity == 0) {
+			return;
+		}
+		auto it = s.index.find(key);
+		if (it != s.index.end()) {
+			it->second->second = value;
+			s.items.splice(s.items.begin(), s.items, it->second);
+			return;
+		}
+		s.items.emplace_front(key, value);
+		s.index[key] = s.items.begin();
+		Shard::trim(s);
+	}
+
+	void clear() {
+		for (auto& s : shards) {
+			std::lock_guard<std::mutex> guard(s->lock);
+			s->items.clear();
+			s->index.clear();
+		}
+	}
+
+	size_t size() const {
+		size_t n = 0;
+		for (auto& s : shards) {
+			std::lock_guard<std::mutex> guard(s->lock);
+			n += s->items.size();
+		}
+		return n;
+	}
+
+	size_t getCapacity() const {
+		return capacity;
+	}
+
+	/*
+	 Shrinking drops the least recently used entries straight away.
+	 */
+	void setCapacity(size_t _capacity) {
+		capacity = _capacity;
+		//the remainder goes one entry each to the first shards
+		size_t perShard = _capacity / shards.size();
+		size_t extra = _capacity % shards.size();
+		for (size_t i = 0; i < shards.size(); i++) {
+			Shard& s = *shards[i];
+			std::lock_guard<std::mutex> guard(s.lock);
+			s.capacity = perShard + (i < extra ? 1 : 0);
+			Shard::trim(s);
+		}
+	}
+
+
+  private:
+
+	typedef std::list<std::pair<Key, Value> > Items;
+
+	struct Shard {
+		mutable std::mutex lock;
+		Items items;//most recently used first
+		std::unordered_map<Key, typename Items::iterator, Hash> index;
+		size_t capacity = 0;
+
+		static void trim(Shard& s) {
+			while (s.items.size() > s.capacity) {
+				s.index.erase(s.items.back().first);
+				s.items.pop_back();
+			}
+		}
+	};
+
+	Shard& getShard(const Key& key) {
+		//mixed so that keys differing only in their low bits still spread
+		uint64_t h = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ull;
+		return *shards[(size_t)(h >> 32) % shards.size()];
+	}
+
+	std::vector<std::unique_ptr<Shard> > shards;
+	std::atomic<size_t> capacity;
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,426 @@
+/*
+ *  MidiSegmenter.h
+ *  MusicTheory
+ *
+ *  Cuts a live or recorded MIDI stream into chord spans. Events go into a
+ *  fixed size ring buffer (safe for one producer thread, eg. a MIDI
+ *  callback, and one consumer), drain() turns them into spans of constant
+ *  sounding pitches, with the sustain pedal (CC64) keeping released keys
+ *  sounding.
+ *
+ *  {{{
+ *  MidiSegmenter segmenter;
+ *  segmenter.push(MidiEvent::noteOn(0.00, 60));
+ *  segmenter.push(MidiEvent::noteOn(0.01, 64));
+ *  segmenter.push(MidiEvent::noteOn(0.02, 67));
+ *  segmenter.push(MidiEvent::noteOff(1.00, 60)); ...
+ *  std::vector<ChordSpan> spans;
+ *  segmenter.drain(spans);
+ *  Chord::determine(spans[0].getNotes(), true) -> ["M"]
+ *  }}}
+ *
+ *  Every event is constant work on bit masks, nothing is allocated after
+ *  construction. Spans are plain values, Notes are only made when asked
+ *  for with getNotes(). Keep spans reserved to stay allocation free.
+ *
+ */
+
+#ifndef _MidiSegmenter
+#define _MidiSegmenter
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Chromagram.h"
+#include "Note.h"
+
+namespace MusicTheory{
+
+	struct MidiEvent {
+		double time = 0;			//seconds
+		unsigned char status = 0;	//raw midi status byte, type | channel
+		unsigned char data1 = 0;
+		unsigned char data2 = 0;
+
+		static const unsigned char NOTE_OFF = 0x80;
+		static const unsigned char NOTE_ON = 0x90;
+		static const unsigned char CONTROL = 0xB0;
+		static const unsigned char SUSTAIN = 64;
+
+		static MidiEvent noteOn(double time, int pitch, int velocity = 100, int channel = 0) {
+			return MidiEvent::make(time, NOTE_ON | channel, pitch, velocity);
+		}
+
+		static MidiEvent noteOff(double time, int pitch, int channel = 0) {
+			return MidiEvent::make(time, NOTE_OFF | channel, pitch, 0);
+		}
+
+		static MidiEvent sustain(double time, bool down, int channel = 0) {
+			return MidiEvent::make(time, CONTROL | channel, SUSTAIN, down ? 127 : 0);
+		}
+
+		static MidiEvent make(double time, int status, int data1, int data2) {
+			MidiEvent e;
+			e.time = time;
+			e.status = (unsigned char)status;
+			e.data1 = (unsigned char)(data1 & 0x7F);
+			e.data2 = (unsigned char)(data2 & 0x7F);
+			return e;
+		}
+
+		int getType() const {
+			return status & 0xF0;
+		}
+
+		int getChannel() const {
+			return status & 0x0F;
+		}
+	};
+
+
+	struct ChordSpan {
+		double onset = 0;			//seconds
+		double offset = 0;
+		uint64_t pitches[2] = { 0, 0 };//sounding midi pitches, bit p of pitches[p >> 6]
+		int count = 0;				//number of sounding pitches
+		int bass = -1;				//lowest sounding pitch
+		int pitchClasses = 0;		//bit mask, C = bit 0
+
+		bool hasPitch(int pitch) const {
+			return pitch >= 0 && pitch < 128 && ((pitches[pitch >> 6] >> (pitch & 63)) & 1);
+		}
+
+		double getDuration() const {
+			return offset - onset;
+		}
+
+		/*
+		 Sounding notes from the bass up, ready for Chord::determine. With
+		 unique, octave doublings are left out and each pitch class is kept
+		 at its lowest.
+		 */
+		std::deque<NotePtr> getNotes(bool unique = true) const {
+			std::deque<NotePtr> notes;
+			int seen = 0;
+			for (int p = 0; p < 128; p++) {
+				if (!hasPitch(p) || (unique && (seen & (1 << (p % 12))))) {
+					continue;
+				}
+				seen |= 1 << (p % 12);
+				notes.push_back(Note::fromInt(p));
+			}
+			return notes;
+		}
+
+		/*
+		 Pitch classes as a unit length Chroma, for ChordRecognizer.
+		 */
+		Chroma getChroma() const {
+			Chroma c;
+			for (int i = 0; i < 12; i++) {
+				c[i] = (pitchClasses >> i) & 1 ? 1.0f : 0.0f;
+			}
+			Chromagram::normalize(c);
+			return c;
+		}
+	};
+
+
+	struct MidiSegmenterSettings {
+		int capacity = 1024;		//ring buffer events, rounded up to a power of two
+		int minNotes = 3;			//spans with fewer sounding pitches are not reported
+		double minDuration = 0.08;	//shorter spans between two chords are passing notes or a sloppy chord change
+		double arpeggioTime = 0.5;	//notes added this soon after a span started join it instead of starting a new one
+		int ignoreChannel = 9;		//drums, -1 to use every channel
+	};
+
+
+
+class MidiSegmenter {
+
+  public:
+
+	MidiSegmenter(MidiSegmenterSettings _settings = MidiSegmenterSettings()) {
+		settings = _settings;
+		int capacity = 1;
+		while (capacity < settings.capacity) {
+			capacity <<= 1;
+		}
+		settings.capacity = capacity;
+		ring.resize(capacity);
+		head = 0;
+		tail = 0;
+		reset();
+	}
+
+	/*
+	 Forgets held keys, pedals and the open span. Not thread safe against push().
+	 */
+	void reset() {
+		head.store(0);
+		tail.store(0);
+		std::fill(soundingCount, soundingCount + 128, 0);
+		std::fill(classCount, classCount + 12, 0);
+		for (int c = 0; c < 16; c++) {
+			down[c][0] = down[c][1] = 0;
+			sustained[c][0] = sustained[c][1] = 0;
+			pedal[c] = false;
+		}
+		current = ChordSpan();
+		grew = true;
+		dropped = -1;
+		lastTime = 0;
+	}
+
+
+	/*
+	 Producer side. Returns false, and drops the event, when the ring is full.
+	 */
+	bool push(const MidiEvent& event) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) >= ring.size()) {
+			return false;
+		}
+		ring[t & (ring.size() - 1)] = event;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 Consumer side. Handles every queued event and appends finished spans.
+	 Returns the number of events handled.
+	 */
+	int drain(std::vector<ChordSpan>& spans) {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t t = tail.load(std::memory_order_acquire);
+		int handled = 0;
+		for (; h != t; h++, handled++) {
+			handle(ring[h & (ring.size() - 1)], spans);
+			head.store(h + 1, std::memory_order_release);
+		}
+		return handled;
+	}
+
+	/*
+	 Whole recorded stream, time ordered. Goes through the ring in chunks and
+	 closes the last span at the final event.
+	 */
+	void process(const MidiEvent* events, int count, std::vector<ChordSpan>& spans) {
+		for (int i = 0; i < count; i++) {
+			while (!push(events[i])) {
+				drain(spans);
+			}
+		}
+		drain(spans);
+		if (count > 0) {
+			flush(events[count - 1].time, spans);
+		}
+	}
+
+	/*
+	 Ends the open span at time, eg. at the end of a file or when playback stops.
+	 */
+	void flush(double time, std::vector<ChordSpan>& spans) {
+		close(time, 0, spans);
+		current.onset = time;
+		dropped = -1;
+	}
+
+
+	/*
+	 One event straight to the segmenter, without the ring.
+	 */
+	void handle(const MidiEvent& event, std::vector<ChordSpan>& spans) {
+		int channel = event.getChannel();
+		if (channel == settings.ignoreChannel) {
+			return;
+		}
+		int type = event.getType();
+		int pitch = event.data1;
+		lastTime = event.time;
+
+		if (type == MidiEvent::NOTE_ON && event.data2 > 0) {
+			if (!MidiSegmenter::test(down[channel], pitch) && !MidiSegmenter::test(sustained[channel], pitch)) {
+				sound(pitch, event.time, spans);
+			}
+			MidiSegmenter::set(down[channel], pitch);
+			MidiSegmenter::clear(sustained[channel], pitch);
+		}
+		else if (type == MidiEvent::NOTE_OFF || type == MidiEvent::NOTE_ON) {
+			if (!MidiSegmenter::test(down[channel], pitch)) {
+				return;
+			}
+			MidiSegmenter::clear(down[channel], pitch);
+			if (pedal[channel]) {
+				MidiSegmenter::set(sustained[channel], pitch);
+			}
+			else {
+				silence(pitch, event.time, spans);
+			}
+		}
+		else if (type == MidiEvent::CONTROL && pitch == MidiEvent::SUSTAIN) {
+			bool isDown = event.data2 >= 64;
+			if (isDown == pedal[channel]) {
+				return;
+			}
+			pedal[channel] = isDown;
+			if (!isDown) {
+				//the pedal releases its notes together, one span ends here, not one per note.
+				//Each of them was set by one note off, so this stays constant per event amortized
+				int ending = 0;
+				for (int w = 0; w < 2; w++) {
+					for (uint64_t bits = sustained[channel][w]; bits; bits &= bits - 1) {
+						ending += soundingCount[w * 64 + MidiSegmenter::lowestBit(bits)] == 1;
+					}
+				}
+				if (ending > 0) {
+					close(event.time, current.count - ending, spans);
+					current.onset = dropped >= 0 ? dropped : event.time;
+					dropped = -1;
+					grew = false;
+				}
+				for (int w = 0; w < 2; w++) {
+					while (sustained[channel][w]) {
+						int p = w * 64 + MidiSegmenter::lowestBit(sustained[channel][w]);
+						sustained[channel][w] &= sustained[channel][w] - 1;
+						silence(p, event.time, spans, false);
+					}
+				}
+			}
+		}
+	}
+
+
+	//pitches sounding now, as an open span up to the last event
+	ChordSpan getCurrent() const {
+		ChordSpan s = current;
+		s.offset = lastTime;
+		return s;
+	}
+
+	const MidiSegmenterSettings& getSettings() const {
+		return settings;
+	}
+
+
+  private:
+
+	MidiSegmenterSettings settings;
+
+	std::vector<MidiEvent> ring;
+	std::atomic<size_t> head;//next event to handle
+	std::atomic<size_t> tail;//next free slot
+
+	uint64_t down[16][2];
+	uint64_t sustained[16][2];//released under the pedal
+	bool pedal[16];
+	unsigned char soundingCount[128];//channels sounding each pitch
+	unsigned char classCount[12];
+
+	ChordSpan current;	//pitches sounding since current.onset
+	bool grew;			//current only gained notes since its onset
+	double dropped;		//onset of a span that was too short, the next one starts there, -1 for none
+	double lastTime;
+
+
+	void sound(int pitch, double time, std::vector<ChordSpan>& spans) {
+		if (soundingCount[pitch]++ > 0) {
+			return;
+		}
+		//arpeggiated or rolled chords: keep adding to a young span
+		bool joins = grew && current.count > 0 && time - current.onset < settings.arpeggioTime;
+		if (!joins) {
+			close(time, current.count + 1, spans);
+			current.onset = dropped >= 0 ? dropped : time;
+			dropped = -1;
+			grew = true;
+		}
+		MidiSegmenter::set(current.pitches, pitch);
+		current.count++;
+		if (classCount[pitch % 12]++ == 0) {
+			current.pitchClasses |= 1 << (pitch % 12);
+		}
+		if (current.bass < 0 || pitch < current.bass) {
+			current.bass = pitch;
+		}
+	}
+
+	void silence(int pitch, double time, std::vector<ChordSpan>& spans, bool ends = true) {
+		if (soundingCount[pitch] == 0 || --soundingCount[pitch] > 0) {
+			return;
+		}
+		if (ends) {
+			close(time, current.count - 1, spans);
+			current.onset = dropped >= 0 ? dropped : time;
+			dropped = -1;
+			grew = false;
+		}
+		MidiSegmenter::clear(current.pitches, pitch);
+		current.count--;
+		if (--classCount[pitch % 12] == 0) {
+			current.pitchClasses &= ~(1 << (pitch % 12));
+		}
+		if (pitch == current.bass) {
+			current.bass = current.pitches[0] ? MidiSegmenter::lowestBit(current.pitches[0]) : current.pitches[1] ? 64 + MidiSegmenter::lowestBit(current.pitches[1]) : -1;
+		}
+	}
+
+	/*
+	 Reports current if it is a chord. A short one that gives way to another
+	 chord (next sounding pitches) is a passing note or overlapping legato,
+	 it is skipped and the next span starts where it started. A short one
+	 left by releasing part of a chord is skipped too, a short one that was
+	 played as such (staccato) is reported.
+	 */
+	void close(double time, int next, std::vector<ChordSpan>& spans) {
+		if (current.count < settings.minNotes) {
+			return;
+		}
+		if (time - current.onset < settings.minDuration) {
+			if (next >= settings.minNotes) {
+				if (dropped < 0) {
+					dropped = current.onset;
+				}
+				return;
+			}
+			if (!grew) {
+				return;
+			}
+		}
+		ChordSpan s = current;
+		s.offset = time;
+		spans.push_back(s);
+	}
+
+
+	static bool test(const uint64_t* bits, int i) {
+		return (bits[i >> 6] >> (i & 63)) & 1;
+	}
+
+	static void set(uint64_t* bits, int i) {
+		bits[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+
+	static void clear(uint64_t* bits, int i) {
+		bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+	}
+
+	static int lowestBit(uint64_t x) {
+		int i = 0;
+		if (!(x & 0xFFFFFFFF)) { x >>= 32; i += 32; }
+		if (!(x & 0xFFFF)) { x >>= 16; i += 16; }
+		if (!(x & 0xFF)) { x >>= 8; i += 8; }
+		if (!(x & 0xF)) { x >>= 4; i += 4; }
+		if (!(x & 0x3)) { x >>= 2; i += 2; }
+		if (!(x & 0x1)) { i += 1; }
+		return i;
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ *  NeoRiemannian.h
+ *  MusicTheory
+ *
+ *  Neo-Riemannian transforms between the 24 major and minor triads and
+ *  their place on the Tonnetz.
+ *
+ *  P swaps major and minor on the same root, C <-> Cm.
+ *  R goes to the relative, C <-> Am.
+ *  L moves the root a semitone against the fifth, C <-> Em.
+ *  The compounds N (RLP), S (LPR) and H (LPL) can be written as one
+ *  letter. Transform strings apply left to right.
+ *
+ *  {{{
+ *  >>> NeoRiemannian::getName(NeoRiemannian::transform(NeoRiemannian::getTriad(Chord::create("C")), "RL"))
+ *  "F"
+ *  >>> NeoRiemannian::getPath(Chord::create("C"), Chord::create("Ebm"))
+ *  "PRP"
+ *  >>> NeoRiemannian::getDistance(Chord::create("C"), Chord::create("Ebm"))
+ *  3
+ *  }}}
+ *
+ *  Triads are numbered 0 to 23, the major ones by root then the minor
+ *  ones, Cm = 12. Shortest paths between every pair, by P, L and R or
+ *  with the compounds as single steps too, are found once by breadth
+ *  first search, so a distance is a table read.
+ *
+ */
+
+#ifndef _NeoRiemannian
+#define _NeoRiemannian
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Chord.h"
+
+namespace MusicTheory{
+
+	//x counts fifths, y major thirds, pitch classes fold into 0 <= x < 4, 0 <= y < 3
+	struct TonnetzPoint {
+		float x = 0;
+		float y = 0;
+		bool valid = false;
+	};
+
+
+
+class NeoRiemannian {
+
+  public:
+
+	static const int TRIADS = 24;
+	static const uint8_t NO_PATH = 255;
+
+
+	static int getTriad(int root, bool minor) {
+		return (((root % 12) + 12) % 12) + (minor ? 12 : 0);
+	}
+
+	/*
+	 The major or minor triad a chord is built on, so G7 is G and Dm9 is
+	 Dm. -1 for chords without a third and a perfect fifth, eg. Bdim or
+	 Csus4.
+	 */
+	static int getTriad(ChordPtr chord) {
+		if (!chord || !chord->root || !chord->isValid()) {
+			return -1;
+		}
+		int signature = chord->getIntervalSignature();
+		if (!(signature & ChordSignature::FIFTH)) {
+			return -1;
+		}
+		bool major = (signature & ChordSignature::MAJOR_THIRD) != 0;
+		bool minor = (signature & ChordSignature::MINOR_THIRD) != 0;
+		if (major == minor) {
+			return -1;
+		}
+		return NeoRiemannian::getTriad(chord->root->toInt(true), minor);
+	}
+
+	static int getRoot(int triad) {
+		return triad % 12;
+	}
+
+	static bool isMinor(int triad) {
+		return triad >= 12;
+	}
+
+	//built with Chord::majorTriad or Chord::minorTriad
+	static ChordPtr getChord(int triad) {
+		if (triad < 0 || triad >= TRIADS) {
+			return nullptr;
+		}
+		static const char* majorRoots[12] = { "C", "Db", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B" };
+		static const char* minorRoots[12] = { "C", "C#", "D", "Eb", "E", "F", "F#", "G", "G#", "A", "Bb", "B" };
+		int root = NeoRiemannian::getRoot(triad);
+		if (NeoRiemannian::isMinor(triad)) {
+			return Chord::minorTriad(Note::create(minorRoots[root]));
+		}
+		return Chord::majorTriad(Note::create(majorRoots[root]));
+	}
+
+	static std::string getName(int triad) {
+		ChordPtr chord = NeoRiemannian::getChord(triad);
+		return chord ? chord->root->name + (NeoRiemannian::isMinor(triad) ? "m" : "") : "";
+	}
+
+
+	/*
+	 One of P, L, R, N, S or H. -1 for anything else or an invalid triad.
+	 */
+	static int transform(int triad, char t) {
+		if (triad < 0 || triad >= TRIADS) {
+			return -1;
+		}
+		int root = NeoRiemannian::getRoot(triad);
+		bool minor = NeoRiemannian::isMinor(triad);
+		switch (t) {
+			case 'P':
+				return NeoRiemannian::getTriad(root, !minor);
+			case 'R':
+				return NeoRiemannian::getTriad(minor ? root + 3 : root - 3, !minor);
+			case 'L':
+				return NeoRiemannian::getTriad(minor ? root - 4 : root + 4, !minor);
+			case 'N':
+				return NeoRiemannian::transform(triad, "RLP");
+			case 'S':
+				return NeoRiemannian::transform(triad, "LPR");
+			case 'H':
+				return NeoRiemannian::transform(triad, "LPL");
+			default:
+				return -1;
+		}
+	}
+
+	static int transform(int triad, const std::string& transforms) {
+		for (char t : transforms) {
+			triad = NeoRiemannian::transform(triad, t);
+		}
+		return triad;
+	}
+
+	static ChordPtr transform(ChordPtr chord, const std::string& transforms) {
+		return NeoRiemannian::getChord(NeoRiemannian::transform(NeoRiemannian::getTriad(chord), transforms));
+	}
+
+
+	/*
+	 Fewest transforms from one triad to the other, NO_PATH if either is
+	 not a triad. compound counts N, S and H as one step each.
+	 */
+	static int getDistance(int from, int to, bool compound = false) {
+		if (from < 0 || from >= TRIADS || to < 0 || to >= TRIADS) {
+			return NO_PATH;
+		}
+		return NeoRiemannian::getTable(compound).distances[from * TRIADS + to];
+	}
+
+	static int getDistance(ChordPtr from, ChordPtr to, bool compound = false) {
+		return NeoRiemannian::getDistance(NeoRiemannian::getTriad(from), NeoRiemannian::getTriad(to), compound);
+	}
+
+	/*
+	 A shortest transform string, eg. "LR", one of them where there are
+	 several. Empty if from is to or there is no path.
+	 */
+	static std::string getPath(int from, int to, bool compound = false) {
+		std::string path;
+		if (NeoRiemannian::getDistance(from, to, compound) == NO_PATH) {
+			return path;
+		}
+		const Table& t = NeoRiemannian::getTable(compound);
+		while (from != to) {
+			char step = t.steps[from * TRIADS + to];
+			path += step;
+			from = NeoRiemannian::transform(from, step);
+		}
+		return path;
+	}
+
+	static std::string getPath(ChordPtr from, ChordPtr to, bool compound = false) {
+		return NeoRiemannian::getPath(NeoRiemannian::getTriad(from), NeoRiemannian::getTriad(to), compound);
+	}
+
+
+	/*
+	 Distances of count pairs, from[i] to to[i], into distances. Triads
+	 outside 0 to 23 give NO_PATH.
+	 */
+	static void getDistances(const int* from, const int* to, size_t count, uint8_t* distances, bool compound = false) {
+		const uint8_t* table = NeoRiemannian::getTable(compound).distances;
+		for (size_t i = 0; i < count; i++) {
+			bool valid = (unsigned)from[i] < TRIADS && (unsigned)to[i] < TRIADS;
+			distances[i] = valid ? table[from[i] * TRIADS + to[i]] : NO_PATH;
+		}
+	}
+
+	/*
+	 Every triad of a progression to every other, count * count distances
+	 into matrix by row.
+	 */
+	static void getDistanceMatrix(const int* triads, size_t count, uint8_t* matrix, bool compound = false) {
+		const uint8_t* table = NeoRiemannian::getTable(compound).distances;
+		for (size_t i = 0; i < count; i++) {
+			uint8_t* row = matrix + i * count;
+			if ((unsigned)triads[i] >= TRIADS) {
+				std::fill(row, row + count, NO_PATH);
+				continue;
+			}
+			const uint8_t* distances = table + triads[i] * TRIADS;
+			for (size_t j = 0; j < count; j++) {
+				row[j] = (unsigned)triads[j] < TRIADS ? distances[triads[j]] : NO_PATH;
+			}
+		}
+	}
+
+	static std::vector<uint8_t> getDistanceMatrix(const std::vector<ChordPtr>& progression, bool compound = false) {
+		std::vector<int> triads = NeoRiemannian::getTriads(progression);
+		std::vector<uint8_t> matrix(triads.size() * triads.size());
+		NeoRiemannian::getDistanceMatrix(triads.data(), triads.size(), matrix.data(), compound);
+		return matrix;
+	}
+
+	static std::vector<int> getTriads(const std::vector<ChordPtr>& progression) {
+		std::vector<int> triads;
+		triads.reserve(progression.size());
+		for (const ChordPtr& chord : progression) {
+			triads.push_back(NeoRiemannian::getTriad(chord));
+		}
+		return triads;
+	}
+
+
+	static TonnetzPoint getTonnetzPoint(int pitchClass) {
+		//pitch class = 7x + 4y
+		static const int x[12] = { 0, 3, 2, 1, 0, 3, 2, 1, 0, 3, 2, 1 };
+		static const int y[12] = { 0, 1, 0, 2, 1, 2, 1, 0, 2, 0, 2, 1 };
+		TonnetzPoint p;
+		pitchClass = ((pitchClass % 12) + 12) % 12;
+		p.x = (float)x[pitchClass];
+		p.y = (float)y[pitchClass];
+		p.valid = true;
+		return p;
+	}
+
+	/*
+	 Centre of the triangle of a triad, on the root's side of the torus.
+	 Major triads point up, root, fifth and third at (x, y), (x + 1, y)
+	 and (x, y + 1). Minor ones point down, the third at (x + 1, y - 1).
+	 */
+	static TonnetzPoint getTonnetzPoint(ChordPtr chord) {
+		int triad = NeoRiemannian::getTriad(chord);
+		if (triad < 0) {
+			return TonnetzPoint();
+		}
+		TonnetzPoint p = NeoRiemannian::getTonnetzPoint(NeoRiemannian::getRoot(triad));
+		if (NeoRiemannian::isMinor(triad)) {
+			p.x += 2.0f / 3;
+			p.y -= 1.0f / 3;
+		}
+		else {
+			p.x += 1.0f / 3;
+			p.y += 1.0f / 3;
+		}
+		return p;
+	}
+
+
+  private:
+
+	struct Table {
+		uint8_t distances[TRIADS * TRIADS];
+		char steps[TRIADS * TRIADS];//first transform of a shortest path, by from * TRIADS + to
+	};
+
+	static const Table& getTable(bool compound) {
+		static const Table plr = NeoRiemannian::makeTable("PLR");
+		static const Table all = NeoRiemannian::makeTable("PLRNSH");
+		return compound ? all : plr;
+	}
+
+	//breadth first from every triad, backwards, so the first step of each path is known
+	static Table makeTable(const std::string& transforms) {
+		Table t;
+		std::fill(t.distances, t.distances + TRIADS * TRIADS, NO_PATH);
+		std::fill(t.steps, t.steps + TRIADS * TRIADS, 0);
+		for (int to = 0; to < TRIADS; to++) {
+			t.distances[to * TRIADS + to] = 0;
+			std::deque<int> queue(1, to);
+			while (queue.size()) {
+				int at = queue.front();
+				queue.pop_front();
+				//every triad one step before at
+				for (int from = 0; from < TRIADS; from++) {
+					if (t.distances[from * TRIADS + to] != NO_PATH) {
+						continue;
+					}
+					for (char step : transforms) {
+						if (NeoRiemannian::transform(from, step) == at) {
+							t.distances[from * TRIADS + to] = t.distances[at * TRIADS + to] + 1;
+							t.steps[from * TRIADS + to] = step;
+							queue.push_back(from);
+							break;
+						}
+					}
+				}
+			}
+		}
+		return t;
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -10,6 +10,7 @@
 #ifndef _Note
 #define _Note
 
+#include <cmath>
 #include <map>
 #include <memory>
 
@@ -17,6 +18,8 @@
 
 #include <mathfu/vector.h>
 
+#include "Allocation.h"
+
 namespace MusicTheory {
 
 
@@ -29,9 +32,9 @@ namespace MusicTheory {
 
 	}Dynamics;
 
-	static const  std::string DiatonicAugNames = "C,C#,D,D#,E,F,F#,G,G#,A,A#,B";
-	static const  std::string DiatonicDimNames = "C,Db,D,Eb,E,F,Gb,G,Ab,A,Bb,B";
-	static const  std::string NoteDictionary = "C,,D,,E,F,,G,,A,,B";
+	inline constexpr char DiatonicAugNames[] = "C,C#,D,D#,E,F,F#,G,G#,A,A#,B";
+	inline constexpr char DiatonicDimNames[] = "C,Db,D,Eb,E,F,Gb,G,Ab,A,Bb,B";
+	inline constexpr char NoteDictionary[] = "C,,D,,E,F,,G,,A,,B";
 
 
 
@@ -78,7 +81,7 @@ namespace MusicTheory {
 	//factory methods
 		std::shared_ptr<Note> copy() {
 			if (isValid()) {
-				return std::shared_ptr<Note>(new Note(*this));//copy
+				return Allocation::make<Note>(*this);//copy
 			}
 			else 
 			{
@@ -92,7 +95,7 @@ namespace MusicTheory {
 		static std::shared_ptr<Note> create(std::string _name = "C", int _oct = 3, Dynamics _dyn = Dynamics()) {
 			if (Note::isValidName(_name)) 
 			{
-				return std::shared_ptr<Note>(new Note(_name, _oct, _dyn));//new
+				return Allocation::make<Note>(_name, _oct, _dyn);//new
 			}
 			else 
 			{
@@ -240,7 +243,7 @@ namespace MusicTheory {
 		}
 		std::shared_ptr<Note> getDiminished(int i = 1) {
 			//NotePtr n = *this;
-			std::shared_ptr<Note> n = std::shared_ptr<Note>(new Note(*this));
+			std::shared_ptr<Note> n = Allocation::make<Note>(*this);
 			n->diminish(i);
 			return n;
 		}
@@ -255,7 +258,7 @@ namespace MusicTheory {
 		 Returns a natural copy
 		 */
 		std::shared_ptr<Note> getNatural() {
-			std::shared_ptr<Note> n = std::shared_ptr<Note>(new Note(*this));
+			std::shared_ptr<Note> n = Allocation::make<Note>(*this);
 			n->naturalise();
 			return n;
 		}
@@ -423,21 +426,25 @@ namespace MusicTheory {
 		 Else considers octave.
 		 */
 		int  toInt(bool relative = false) const {
-			// 
-
-			if (!&name) {
+			if (!name.size()) {
 #ifdef LOGS
 				cout << "Warning: No name" << endl;
 #endif // LOGS
 				return 0;
 			}
-			//root note
-			std::string root = name.substr(0, 1);
-			auto nNames = utils::splitString(NoteDictionary, ",");
-			std::vector<std::string>::iterator it = find(nNames.begin(), nNames.end(), root);
-			int uid = it - nNames.begin();
+			//position in NoteDictionary, unknown letters land past the end like before
+			static const int letters[7] = { 9, 11, 0, 2, 4, 5, 7 };//A-G
+			int uid = (name[0] >= 'A' && name[0] <= 'G') ? letters[name[0] - 'A'] : 12;
 
-			int numberOfAccidentals = utils::getNumberOfAccidentals(name);
+			int numberOfAccidentals = 0;
+			for (char c : name) {
+				if (c == '#') {
+					numberOfAccidentals++;
+				}
+				else if (c == 'b') {
+					numberOfAccidentals--;
+				}
+			}
 
 			if (relative) {
 				int val = uid + numberOfAccidentals;
@@ -536,26 +543,33 @@ namespace MusicTheory {
 
 
 		/*
-		 Returns the Note in Hz. The `standard_pitch` argument can be used \
-		to set the pitch of A-4, from which the rest is calculated.
-		 Not done.
+		 Returns the Note in Hz, 12-TET. The `standardPitch` argument can be used \
+		to set the pitch of A-3 (midi 69), from which the rest is calculated.
+		 For other tuning systems see Tuning.
 		 */
 		float toHertz(int standardPitch = 440) {
-			float diff = toInt() - 57.0;
-			return pow(2, (diff / 12.0)) * 440;
+			float diff = toInt() - 69.0;
+			return pow(2, (diff / 12.0)) * standardPitch;
 		}
 
 
 		/*
 		 Sets the Note name and pitch, calculated from the `hertz` value. \
-		 The `standard_pitch` argument can be used to set the pitch of A-4, from \
-		 which the rest is calculated.*/
+		 The `standard_pitch` argument can be used to set the pitch of A-3, from \
+		 which the rest is calculated. Returns the midi number, 0 and unchanged
+		 if hertz is out of range. Tuning::fromHertz also gives the cents off.
+		 */
 
 		int fromHertz(float hertz, int standardPitch = 440) {
-			/*value = log(float(hertz) / standardPitch, 2) * 12 + Note("A").toInt();
-			name = notes.int_to_note(int(value) % 12);
-			octave = int(value / 12) + 4;*/
-			return 0;
+			if (hertz <= 0 || standardPitch <= 0) {
+				return 0;
+			}
+			int value = (int)std::lround(69 + 12 * std::log2(hertz / standardPitch));
+			if (value < 0) {
+				return 0;
+			}
+			set(value);
+			return value;
 		}
 
 
@@ -671,21 +685,19 @@ namespace MusicTheory {
 			}
 		}
 
-		static bool isValidName(std::string _name)
+		static bool isValidName(const std::string& _name)
 		{
-			boost::regex rex{ "[a-gA-G][[b|#]*]?[\-]?[0-9]?" };
-			boost::smatch match;
-			if (boost::regex_search(_name, match, rex))
-			{
-				return true;
+			//same answer as searching for [a-gA-G][[b|#]*]?[\-]?[0-9]? since everything
+			//after the letter is optional, without compiling a regex on every factory call
+			for (char c : _name) {
+				if ((c >= 'a' && c <= 'g') || (c >= 'A' && c <= 'G')) {
+					return true;
+				}
 			}
-			else
-			{
 #ifdef LOGS
-				ofLogError() << "The std::string " << _name << " is not a valid representation of a note" << endl;
+			ofLogError() << "The std::string " << _name << " is not a valid representation of a note" << endl;
 #endif // LOGS
-				return false;
-			}
+			return false;
 		}
 
 		static std::shared_ptr<Note> fromInt(int val) {
@@ -0,0 +1,338 @@
+/*
+ *  PitchTracker.h
+ *  MusicTheory
+ *
+ *  Streaming monophonic pitch tracker (YIN, de Cheveigne & Kawahara 2002).
+ *  Feed it audio blocks of any size, it analyses a frame every hopSize
+ *  samples and reports a PitchEvent whenever the held note changes.
+ *
+ *  {{{
+ *  PitchTracker tracker;
+ *  tracker.setScale(Scale::getIonian("C"));
+ *  std::vector<PitchEvent> events;
+ *  tracker.process(block, 512, events);
+ *  }}}
+ *
+ *  Nothing is allocated per block. Events are the only thing that create
+ *  Notes, and there is one per note change, not one per frame.
+ *
+ */
+
+#ifndef _PitchTracker
+#define _PitchTracker
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Note.h"
+#include "Scale.h"
+#include "Tuning.h"
+
+namespace MusicTheory{
+
+	struct PitchTrackerSettings {
+		float sampleRate = 44100;
+		int windowSize = 2048;		//samples summed per lag, should cover two periods of the lowest note
+		int hopSize = 256;			//samples between frames, sets the latency, at most one frame
+		float minFrequency = 70;
+		float maxFrequency = 1600;
+		float threshold = 0.15;		//YIN absolute threshold, lower is stricter
+		float silence = 0.01;		//rms below this is unvoiced
+		int holdFrames = 2;			//frames a new note has to last before it is reported
+	};
+
+
+	struct PitchEvent {
+		double time = 0;			//seconds from the first sample to the frame the note started in
+		NotePtr note;				//null for a note off
+		int pitch = -1;				//midi, -1 for a note off
+		float cents = 0;			//deviation from pitch, after snapping to the scale if one is set
+		float frequency = 0;
+		float confidence = 0;		//1 - YIN aperiodicity
+		int degree = -1;			//scale degree from 0 when a scale is set
+	};
+
+
+
+class PitchTracker {
+
+  public:
+
+	PitchTracker(PitchTrackerSettings _settings = PitchTrackerSettings(), Tuning _tuning = Tuning()) {
+		settings = _settings;
+		tuning = _tuning;
+		settings.holdFrames = std::max(1, settings.holdFrames);
+		minTau = std::max(2, (int)std::floor(settings.sampleRate / settings.maxFrequency));
+		maxTau = std::max(minTau + 2, (int)std::ceil(settings.sampleRate / settings.minFrequency));
+		frameSize = settings.windowSize + maxTau + 1;
+		settings.hopSize = std::max(1, std::min(settings.hopSize, frameSize));
+		buffer.assign(frameSize, 0.0f);
+		cmnd.assign(maxTau + 2, 1.0f);
+		reset();
+	}
+
+
+	/*
+	 Snap reported notes to the scale, using Scale::getDegree for the
+	 degrees and the scale's own spelling. Pass nullptr to stop snapping.
+	 */
+	void setScale(ScalePtr scale) {
+		scaleMask = 0;
+		std::fill(degrees, degrees + 12, -1);
+		std::fill(spelling, spelling + 12, std::string());
+		if (!scale || !scale->isValid()) {
+			return;
+		}
+		for (NotePtr n : scale->notes) {
+			int pc = n->toInt(true);
+			pc = ((pc % 12) + 12) % 12;
+			if (degrees[pc] < 0) {
+				degrees[pc] = scale->getDegree(n);
+				spelling[pc] = n->name;
+				scaleMask |= 1 << pc;
+			}
+		}
+	}
+
+	void reset() {
+		filled = 0;
+		position = 0;
+		current = -1;
+		candidate = -1;
+		candidateFrames = 0;
+		candidateTime = 0;
+		frequency = 0;
+		confidence = 0;
+	}
+
+
+	/*
+	 Consumes count samples and appends any note changes to events.
+	 Returns the number of frames analysed.
+	 */
+	int process(const float* samples, int count, std::vector<PitchEvent>& events) {
+		int frames = 0;
+		while (count > 0) {
+			int n = std::min(count, frameSize - filled);
+			std::memcpy(buffer.data() + filled, samples, n * sizeof(float));
+			filled += n;
+			samples += n;
+			count -= n;
+
+			if (filled == frameSize) {
+				analyse(events);
+				frames++;
+				std::memmove(buffer.data(), buffer.data() + settings.hopSize, (frameSize - settings.hopSize) * sizeof(float));
+				filled -= settings.hopSize;
+				position += settings.hopSize;
+			}
+		}
+		return frames;
+	}
+
+
+	/*
+	 Frequency of one frame, 0 if unvoiced. frame needs windowSize + maxTau + 1
+	 samples and cmnd maxTau + 2 floats of scratch.
+	 */
+	static float detect(const float* frame, int windowSize, int minTau, int maxTau, float threshold, float sampleRate, float* cmnd, float* confidence = nullptr) {
+		if (confidence) {
+			*confidence = 0;
+		}
+		cmnd[0] = 1.0f;
+		float sum = 0;
+		int found = -1;
+		int last = maxTau;
+		for (int tau = 1; tau <= maxTau + 1; tau++) {
+			float d = PitchTracker::difference(frame, windowSize, tau);
+			sum += d;
+			cmnd[tau] = sum > 0 ? d * tau / sum : 1.0f;
+			//first dip under the threshold, taken at its bottom
+			if (tau > minTau + 1 && cmnd[tau - 1] < threshold && cmnd[tau] >= cmnd[tau - 1]) {
+				found = tau - 1;
+				last = tau;
+				break;
+			}
+		}
+		if (found < 0) {
+			return 0;
+		}
+
+		//parabolic interpolation around the minimum
+		float a = cmnd[found - 1], b = cmnd[found], c = found + 1 <= last ? cmnd[found + 1] : b;
+		float denom = a - 2 * b + c;
+		float shift = std::abs(denom) > 1e-9f ? 0.5f * (a - c) / denom : 0.0f;
+		shift = std::max(-0.5f, std::min(0.5f, shift));
+		if (confidence) {
+			*confidence = std::max(0.0f, 1.0f - b);
+		}
+		return sampleRate / (found + shift);
+	}
+
+
+	//last analysed frame
+	float getFrequency() const {
+		return frequency;
+	}
+
+	float getConfidence() const {
+		return confidence;
+	}
+
+	//samples of delay between audio in and a frame being analysed
+	int getLatency() const {
+		return frameSize;
+	}
+
+	const PitchTrackerSettings& getSettings() const {
+		return settings;
+	}
+
+
+  private:
+
+	PitchTrackerSettings settings;
+	Tuning tuning;
+	int minTau, maxTau, frameSize;
+
+	std::vector<float> buffer;
+	std::vector<float> cmnd;
+	int filled;
+	long long position;//samples consumed before buffer[0]
+
+	int current;//held pitch, -1 for none
+	int candidate;
+	int candidateFrames;
+	double candidateTime;
+	float candidateCents;
+	float candidateFrequency;
+	float candidateConfidence;
+
+	float frequency;
+	float confidence;
+
+	int scaleMask = 0;
+	int degrees[12];
+	std::string spelling[12];
+
+
+	void analyse(std::vector<PitchEvent>& events) {
+		const float* frame = buffer.data();
+		float energy = 0;
+		for (int i = 0; i < settings.windowSize; i++) {
+			energy += frame[i] * frame[i];
+		}
+		float rms = std::sqrt(energy / settings.windowSize);
+
+		frequency = 0;
+		confidence = 0;
+		if (rms >= settings.silence) {
+			frequency = PitchTracker::detect(frame, settings.windowSize, minTau, maxTau, settings.threshold, settings.sampleRate, cmnd.data(), &confidence);
+		}
+
+		int pitch = -1;
+		float cents = 0;
+		if (frequency > 0) {
+			PitchEstimate e = tuning.fromHertz(frequency);
+			pitch = e.pitch;
+			cents = e.cents;
+			if (pitch >= 0 && scaleMask) {
+				int snapped = snap(pitch + cents / 100.0f);
+				cents += (pitch - snapped) * 100.0f;
+				pitch = snapped;
+			}
+		}
+
+		if (pitch == current) {
+			candidate = current;
+			candidateFrames = 0;
+			return;
+		}
+		if (pitch != candidate || candidateFrames == 0) {
+			candidate = pitch;
+			candidateFrames = 0;
+			candidateTime = position / (double)settings.sampleRate;
+			candidateCents = cents;
+			candidateFrequency = frequency;
+			candidateConfidence = confidence;
+		}
+		candidateFrames++;
+		if (candidateFrames < settings.holdFrames) {
+			return;
+		}
+
+		current = candidate;
+		candidateFrames = 0;
+
+		PitchEvent e;
+		e.time = candidateTime;
+		e.pitch = current;
+		if (current >= 0) {
+			e.cents = candidateCents;
+			e.frequency = candidateFrequency;
+			e.confidence = candidateConfidence;
+			e.note = makeNote(current);
+			e.degree = scaleMask ? degrees[current % 12] : -1;
+		}
+		events.push_back(e);
+	}
+
+	//nearest scale pitch to a fractional midi pitch
+	int snap(float exact) const {
+		int base = (int)std::lround(exact);
+		int best = base;
+		float bestDistance = 1e9f;
+		for (int offset = -6; offset <= 6; offset++) {
+			int p = base + offset;
+			if (p < 0 || !(scaleMask & (1 << (p % 12)))) {
+				continue;
+			}
+			float distance = std::abs(exact - p);
+			if (distance < bestDistance) {
+				bestDistance = distance;
+				best = p;
+			}
+		}
+		return best;
+	}
+
+	NotePtr makeNote(int pitch) const {
+		int pc = pitch % 12;
+		if (!scaleMask || spelling[pc].empty()) {
+			return Note::fromInt(pitch);
+		}
+		//scale spelling, octave moved so eg. B# still lands on the right pitch
+		NotePtr n = Note::create(spelling[pc], pitch / 12 - 2);
+		n->changeOctave((pitch - n->toInt()) / 12);
+		return n;
+	}
+
+	//YIN difference function for one lag, four sums so the loop pipelines
+	static float difference(const float* x, int windowSize, int tau) {
+		float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		const float* y = x + tau;
+		int i = 0;
+		for (; i + 4 <= windowSize; i += 4) {
+			float d0 = x[i] - y[i];
+			float d1 = x[i + 1] - y[i + 1];
+			float d2 = x[i + 2] - y[i + 2];
+			float d3 = x[i + 3] - y[i + 3];
+			s0 += d0 * d0;
+			s1 += d1 * d1;
+			s2 += d2 * d2;
+			s3 += d3 * d3;
+		}
+		for (; i < windowSize; i++) {
+			float d = x[i] - y[i];
+			s0 += d * d;
+		}
+		return (s0 + s1) + (s2 + s3);
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -13,16 +13,23 @@
 #include <boost/regex.hpp>
 
 #include "Chord.h"
+#include "Config.h"
+#include "LRUCache.h"
+#include "RomanNumeral.h"
 
 
 namespace MusicTheory{
 
-    static std::string ROMAN[] = {"I","II","III","IV","V","VI","VII"};
-    static int numeral_intervals[] = {0, 2, 4, 5, 7, 9, 11};
+    inline constexpr const char* ROMAN[] = {"I","II","III","IV","V","VI","VII"};
+    inline constexpr int numeral_intervals[] = {0, 2, 4, 5, 7, 9, 11};
 
     typedef std::map<std::string, int> IntLookup;
     
-    static IntLookup RomanLookup = {
+#ifdef MUSICTHEORY_TABLES_EXTERN
+    IntLookup makeRomanLookup();
+#else
+    MUSICTHEORY_INLINE IntLookup makeRomanLookup() {
+        return {
         {"I",0},
         {"II",1},
         {"III",2},
@@ -31,12 +38,19 @@ namespace MusicTheory{
         {"VI",5},
         {"VII",6},
     
-    };
+        };
+    }
+#endif
+    inline constexpr LazyTable<IntLookup, &makeRomanLookup> RomanLookup;
     
     typedef ChordPtr (*ChordFunctionPointer)(NotePtr);
     typedef std::map<std::string,ChordFunctionPointer> ChordFunctionLookup;
     
-    static ChordFunctionLookup ChordFunctions ={
+#ifdef MUSICTHEORY_TABLES_EXTERN
+    ChordFunctionLookup makeChordFunctions();
+#else
+    MUSICTHEORY_INLINE ChordFunctionLookup makeChordFunctions() {
+        return {
         {"I", &Chord::I},
         {"IM7", &Chord::IM7},
         {"I7", &Chord::I7},
@@ -54,7 +68,10 @@ namespace MusicTheory{
         {"VII", &Chord::VII},
         {"bVII7", &Chord::bVII7},
         {"VII7", &Chord::VII7}
-    };
+        };
+    }
+#endif
+    inline constexpr LazyTable<ChordFunctionLookup, &makeChordFunctions> ChordFunctions;
 
     
     
@@ -125,26 +142,23 @@ class Progression : public std::enable_shared_from_this<Progression> {
 	
     
     static ChordPtr getChordfromChordFunction(std::string chordFunction, NotePtr key = Note::create("C")){
-        //strip preceding accidentals from the std::string
-        std::vector<std::string> slash = utils::splitString(chordFunction,"/");
-        std::vector<std::string> poly = utils::splitString(chordFunction,"| ");
-        
-        std::string chordTop;
-        std::string bass="";
-        std::string chordBottom="";
+        //one scan for the separators instead of splitting the string twice
+        std::string_view str = chordFunction;
+        size_t slashPos = str.find('/');
+        size_t polyPos = str.find_first_of("| ");
         
+        std::string_view chordTop = str;
+        std::string_view bass;
+        std::string_view chordBottom;
         
-        bool isSlash = Chord::isSlashChord(chordFunction);
-        //TODO: Test slash chords for romans
+        bool isSlash = slashPos != std::string_view::npos && RomanNumeral::tokenize(str.substr(slashPos+1)).valid;
+        bool isPoly = !isSlash && polyPos != std::string_view::npos && str.find_first_of("| ", polyPos+1) == std::string_view::npos;
         if(isSlash){
-            chordTop = slash[0];
-            bass = slash[1];
-        }else if(poly.size()==2){
-            chordTop = poly[0];
-            chordBottom = poly[1];
-        }else{
-            chordTop = chordFunction;
-            
+            chordTop = str.substr(0, slashPos);
+            bass = str.substr(slashPos+1);
+        }else if(isPoly){
+            chordTop = str.substr(0, polyPos);
+            chordBottom = str.substr(polyPos+1);
         }
         
         ChordTuple tuple = Progression::parse(chordTop);
@@ -155,7 +169,7 @@ class Progression : public std::enable_shared_from_this<Progression> {
             ChordPtr bassNote = Progression::tupleToChord(bassTuple,key);
             chord->setBass(bassNote->notes[0]);
             
-        }else if(poly.size()==2){
+        }else if(isPoly){
             ChordTuple polyTuple = Progression::parse(chordBottom);
             ChordPtr polyChord = Progression::tupleToChord(polyTuple,key);
             //I don't know if anything is missing here...for subchord symbols etc
@@ -257,45 +271,30 @@ class Progression : public std::enable_shared_from_this<Progression> {
      */
     
     
-    static ChordTuple parse(std::string progression){
-        boost::replace_all(progression, " ", "");
-        std::string roman_numeral = "";
-        
+    static ChordTuple parse(std::string_view progression){
+        return Progression::parse(RomanNumeral::tokenize(progression));
+    }
+    
+    /*
+     Same as above for an already tokenized chord function.
+     */
+    static ChordTuple parse(const RomanToken& token){
         ChordTuple tuple;
         
-        
-        //http://www.codeproject.com/Articles/9099/The-30-Minute-Regex-Tutorial
-        
-        boost::regex accEx{ "[#b]*(?=[iIvV])" };//find accidentals
-        boost::smatch match;
-        std::string acc;
-
-        if (boost::regex_search(progression, match, accEx))
-            {
-            acc = match[0].str();
+        tuple.accidentals = token.accidentals;
+        if(token.valid){
+            tuple.roman = RomanNumeral::getNumeral(token.degree);
+            tuple.numeral = token.degree;
+        }else{
+            tuple.roman = "";//getChordFromRoman reports it
         }
         
-        
-        int augs = utils::getNumberOfSharps(acc);
-        int dims = utils::getNumberOfFlats(acc);
-        tuple.accidentals = utils::getNumberOfAccidentals(acc);
-
-        std::string roman;
-        roman = progression.substr((augs+dims));//remove accidentals
-      
-        boost::regex romanEx{ "(?<!d)[iIvV]*" };//find all romans not prefixed by d, thus exclude i in dim..
-        if (boost::regex_search(roman, match, romanEx))
-        {
-            roman = match.str();
+        for(char c : token.suffix){
+            if(c != ' '){
+                tuple.suffix += c;
+            }
         }
         
-        std::transform(roman.begin(), roman.end(), roman.begin(), ::toupper);
-        tuple.roman = roman;
-
-        std::string suffix = progression;
-        tuple.suffix = progression.substr(roman.size()+augs+dims);//get suffix if any
-        
-        
         tuple.cleanedAccidentals = Progression::cleanAccidentals(tuple.accidentals);
         
         //fix for the subtonic/leadingtone mixup
@@ -716,31 +715,21 @@ class Progression : public std::enable_shared_from_this<Progression> {
      If using poly chords can return more complex relationships, hence nested vector
      */
     static std::vector< std::vector<std::string> > determine(std::vector<std::string> chordNames, NotePtr key, bool shorthand = false, bool useInversions = true, bool usePoly = true){
-        std::vector< std::vector<std::string> > result;
-        for(std::string chordName:chordNames){
-            std::vector<std::string>progressionInterpretation;
-            result.push_back(progressionInterpretation);
-        }
+        MUSICTHEORY_TIME(InstrumentTimer::ProgressionDetermine);
+        std::vector< std::vector<std::string> > result(chordNames.size());
+        
+        //charts repeat their chords, each distinct one is read and labelled once
+        std::map<std::string, ChordAnalysis> labelled;
         for(int i=0;i<chordNames.size();i++){
-            std::string chordName = chordNames[i];
-            //std::cout<<"Here chordName "<<chordName<<std::endl;
-            ChordPtr chord = Chord::create(chordName);
-            //Chord::print(chord->notes);
-            if(chord->isValid()){
-                std::vector<std::string>progressionInterpretation = Progression::determine(chord->notes,key,shorthand,useInversions,usePoly);
-                for(int ii=0;ii<progressionInterpretation.size();ii++){
-                    result[i].push_back(progressionInterpretation[ii]);
-                }
-                Progression::print(progressionInterpretation);
-                
+            const std::string& chordName = chordNames[i];
+            auto it = labelled.find(chordName);
+            if(it == labelled.end()){
+                it = labelled.emplace(chordName, Progression::analyseName(chordName, key, shorthand, useInversions, usePoly)).first;
             }
-#ifdef LOGS
-            else
-            {
-                ofLogWarning()<<__FUNCTION__<<" "<<chordName<<" not valid"<<std::endl;
-                
+            if(it->second.first){
+                result[i] = it->second.second;
+                Progression::print(result[i]);
             }
-#endif // LOGS
         }
         
         return result;
@@ -752,31 +741,15 @@ class Progression : public std::enable_shared_from_this<Progression> {
         
         boost::replace_all(chordName," ","");
         
-        //check for poly and slash chords
-        std::vector<std::string> slash = utils::splitString(chordName, "/");//different bass
-        std::vector<std::string> poly = utils::splitString(chordName, "|");//combined chords
-        
-        std::string func = "";
-        if(poly.size()==2 && poly[0]!=poly[1]){
-            std::string top = Progression::getFunctionInRoman(poly[0],key,shorthand);
-            std::string bottom = Progression::getFunctionInRoman(poly[1],key,shorthand);
-            func = top+"|"+bottom;
-        }else if(slash.size()==2){
-            std::string top = Progression::getFunctionInRoman(slash[0],key,shorthand);
-            std::string bass = Progression::getFunctionInRoman(slash[1],key,shorthand);
-            func = top+"/"+bass;
-        }else{
-            func = Progression::getFunctionInRoman(chordName,key,shorthand);
-        }
-        
         //this ensures that the first one is the one as it is written
         std::vector<std::string> result;
+        std::string func = Progression::labelWritten(chordName, key, shorthand);
         result.push_back(func);
         
         if(useInversions || usePoly){
-            ChordPtr chord = Chord::getChordFromString(chordName);
-            if(chord->isValid()){
-                std::vector<std::string> permutations = Progression::determine(chord->notes,key,shorthand,useInversions,usePoly);
+            ChordReading reading = Progression::read(chordName, useInversions, usePoly, false);
+            if(reading.chord){
+                std::vector<std::string> permutations = Progression::label(reading, key, shorthand);
                 for(int i=0;i<permutations.size();i++){
                     if(permutations[i]!=func){
                         result.push_back(permutations[i]);
@@ -796,57 +769,156 @@ class Progression : public std::enable_shared_from_this<Progression> {
     
     
     static std::vector<std::string> determine(std::deque<NotePtr> notes, NotePtr key, bool shorthand = true, bool useInversions = true, bool usePoly = false){
-        std::vector<std::string> result;
+        ChordReading reading;
+        reading.names = Progression::recognise(notes, useInversions, usePoly);
+        return Progression::label(reading, key, shorthand);
+    }
+    
+    
+    /*
+     A chord on its way through analysis. It is parsed once from its name,
+     recognised once (Chord::determine on its notes) and only the names that
+     come out of that are labelled with roman numerals, without parsing them
+     into chords again.
+     */
+    typedef struct ChordReading{
+        std::string name;                   //as written
+        ChordPtr chord;                     //null if the name is not a valid chord
+        std::vector<std::string> names;     //Chord::determine of its notes, shorthand
+    }ChordReading;
+    
+    /*
+     Parse and recognise. fromName reads the name the way Chord::create does,
+     else as Chord::getChordFromString.
+     */
+    static ChordReading read(const std::string& chordName, bool useInversions = true, bool usePoly = false, bool fromName = true){
+        ChordReading reading;
+        reading.name = chordName;
+        ChordPtr chord = fromName ? Chord::create(chordName) : Chord::getChordFromString(chordName);
+        if(chord && chord->isValid()){
+            reading.chord = chord;
+            reading.names = Progression::recognise(chord->notes, useInversions, usePoly);
+        }
+        return reading;
+    }
+    
+    static std::vector<std::string> recognise(const std::deque<NotePtr>& notes, bool useInversions = true, bool usePoly = false){
         if(notes.size()==0){
 #ifdef LOGS
             ofLogWarning()<<"Warning: Progression::determine empty notes"<<std::endl;
-            return result;
 #endif // LOGS
         }
         
+        std::vector<std::string> names = Chord::determine(notes, true, useInversions, usePoly);//shorthand,inversion,poly
         
-        //std::cout<<"Progression::determine"<<std::endl;
-        //Chord::print(notes);
-        
-        std::vector<std::string> type_of_chord = Chord::determine(notes, true, useInversions, usePoly);//shorthand,inversion,poly
-        
-        if(!type_of_chord.size()){
+        if(!names.size()){
             std::cout<<std::endl;
             Chord::print(notes);
 #ifdef LOGS
             ofLogWarning()<<" don't give a type"<<std::endl;
 #endif // LOGS
         }
-
-
-        for(int i=0;i<type_of_chord.size();i++){
-            std::string chordStr = type_of_chord[i];
-           // std::cout<<"chordStr "<<chordStr<<std::endl;
-            
-            //check for poly and slash chords
-            std::vector<std::string> slash = utils::splitString(chordStr, "/");//different bass
-            std::vector<std::string> poly = utils::splitString(chordStr, "|");//combined chords
-            
-            
-            
-            std::string func = "";
-            if(poly.size()==2 && poly[0]!=poly[1]){
-                std::string top = Progression::getFunctionInRoman(poly[0],key,shorthand);
-                std::string bottom = Progression::getFunctionInRoman(poly[1],key,shorthand);
-                func = top+"|"+bottom;
-            }else if(Chord::isSlashChord(chordStr)){
-                std::string top = Progression::getFunctionInRoman(slash[0],key,shorthand);
-                std::string bass = Progression::getFunctionInRoman(slash[1],key,shorthand);
-                func = top+"/"+bass;
-            }else{
-                func = Progression::getFunctionInRoman(chordStr,key,shorthand);
-
+        return names;
+    }
+    
+    /*
+     A chord name seen from a key: how far its root is above the key, in
+     letters and in semitones, its symbol, and its bass measured the same
+     way. Dm7 in C and Em7 in D have the same form, and so the same roman
+     numerals, which is what lets an analysis made in one key be reused in
+     all the others.
+     {{{
+     >>> Progression::getChordForm("G7/B", Note::create("C"), form)
+     true, steps 4, semitones 7, symbol Chord::getSymbolId("7"), bassSteps 6, bassSemitones 11
+     }}}
+     */
+    typedef struct ChordForm{
+        int steps = 0;              //root letter above the key letter, 0-6
+        int semitones = 0;          //root pitch class above the key, 0-11
+        int symbol = 0;             //Chord::getSymbolId
+        int bassSteps = -1;         //-1 if not a slash chord
+        int bassSemitones = -1;
+        
+        //the form and the shorthand option as one number
+        uint64_t getId(bool shorthand) const{
+            return (uint64_t)steps | ((uint64_t)semitones << 3) | ((uint64_t)(bassSteps + 1) << 7) | ((uint64_t)(bassSemitones + 1) << 10)
+                | ((uint64_t)shorthand << 14) | ((uint64_t)symbol << 15);
+        }
+    }ChordForm;
+    
+    /*
+     False for names that have no form: polychords, symbols Chord does not
+     know, and roots, basses or keys spelled with anything but a capital
+     letter and at most one sharp or flat, or spelled across C, eg. Cb or B#,
+     which Interval::measure does not wrap. Those are always analysed in full.
+     */
+    static bool getChordForm(const std::string& chordName, NotePtr key, ChordForm& form){
+        if(chordName.find('|') != std::string::npos){
+            return false;
+        }
+        std::string_view name(chordName);
+        std::string_view bass;
+        size_t slash = name.rfind('/');
+        if(slash != std::string_view::npos && slash + 1 < name.size() && name[slash + 1] >= 'A' && name[slash + 1] <= 'G'){
+            bass = name.substr(slash + 1);
+            name = name.substr(0, slash);
+        }
+        size_t rootSize = 1;
+        while(rootSize < name.size() && (name[rootSize] == '#' || name[rootSize] == 'b')){
+            rootSize++;
+        }
+        int keyLetter, keyPitch, rootLetter, rootPitch;
+        if(!Progression::readPitch(key->name, keyLetter, keyPitch) || !Progression::readPitch(name.substr(0, rootSize), rootLetter, rootPitch)){
+            return false;
+        }
+        form.symbol = Chord::getSymbolId(name.substr(rootSize));
+        if(form.symbol < 0){
+            return false;
+        }
+        form.steps = (rootLetter - keyLetter + 7) % 7;
+        form.semitones = (rootPitch - keyPitch + 24) % 12;
+        form.bassSteps = -1;
+        form.bassSemitones = -1;
+        if(bass.size()){
+            int bassLetter, bassPitch;
+            if(!Progression::readPitch(bass, bassLetter, bassPitch)){
+                return false;
             }
-            
+            form.bassSteps = (bassLetter - keyLetter + 7) % 7;
+            form.bassSemitones = (bassPitch - keyPitch + 24) % 12;
+        }
+        return true;
+    }
+    
+    
+    typedef std::pair<bool, std::vector<std::string> > ChordAnalysis;//valid chord, roman numerals
+    
+    /*
+     Analyses of chord forms, shared by every key and thread. Only analyses
+     without inversions or polychords are kept: Chord::determine spells
+     those other readings from pitch classes, eg. A#6 inside Gm9, so they
+     do not transpose. Bounded, the least recently used forms are dropped
+     first. setCapacity(0) turns it off.
+     {{{
+     Progression::getAnalysisCache().setCapacity(100000);
+     }}}
+     */
+    static LRUCache<uint64_t, ChordAnalysis>& getAnalysisCache(){
+        static LRUCache<uint64_t, ChordAnalysis> cache(4096);
+        return cache;
+    }
+    
+    /*
+     Roman numerals for every recognised name, in order. Names that cannot
+     be labelled are left out.
+     */
+    static std::vector<std::string> label(const ChordReading& reading, NotePtr key, bool shorthand = true){
+        std::vector<std::string> result;
+        for(const std::string& chordStr : reading.names){
+            std::string func = Progression::labelName(chordStr, key, shorthand);
             if(func != "")
             {
                 //ofLogVerbose()<<chordStr<<" is "<<func<<" in key "<<key->getName()<<std::endl;
-                // Add to results
                 result.push_back(func);
             }
 #ifdef LOGS
@@ -856,158 +928,78 @@ class Progression : public std::enable_shared_from_this<Progression> {
             }
 #endif // LOGS
         }
-        
         return result;
     }
     
     /*
-    TODO: Use Interval::toRoman and simplify
-    */
-                                                                            
+     Roman numeral for a chord in key.
+     {{{
+     >>> Progression::getFunctionInRoman("Ebm7", Note::create("C"))
+     "bIIIm7"
+     >>> Progression::getFunctionInRoman("Ebm7", Note::create("C"), false)
+     "minor mediant minor seventh"
+     }}}
+     The numeral follows the spelling, so D#m7 in C is #IIm7. Only the names
+     are read, no Chord or Note is built.
+     */
     static std::string getFunctionInRoman(std::string chordStr,NotePtr key, bool shorthand = true){
-        
-        
-        
-        //this only affects shorthand false
-        std::map<std::string, std::string> func_dict = {
-        {"I","tonic"},
-        {"II","supertonic"},
-        {"III","mediant"},
-        {"IV","subdominant"},
-        {"V","dominant"},
-        {"VI","submediant"},
-        {"#VI","subtonic"},
-        {"bVII","subtonic"},
-        {"VII","leadingtone"}
-        };
-        
-
-
-        
-        ChordPtr chord = Chord::getChordFromString(chordStr);
-        
-        if(!chord)
-        {
+        std::string top = Progression::getTopChord(Chord::cleanShorthand(chordStr));
+        if(top.empty()){
+            return "";
+        }
+        std::string root = Chord::getRootNote(top);
+        int symbol = Chord::getSymbolId(Chord::getChordSymbol(top));
+        if(symbol < 0){
 #ifdef LOGS
             ofLogError()<<"Chord "<<chordStr<<" not recognied by Progression::getFunctionInRoman"<<std::endl;
 #endif // LOGS
             return "";
         }
-        //std::cout<<"Determine function for "<<chordStr<<" "<<chord->name<<std::endl;
-        NotePtr root = chord->getRoot();
-        
-        //std::string chord_type = chord.getChordSymbol();
-        
-        std::string chord_type = chord->name;
-        
-        //Determine chord function
-        
-        std::string intv = Interval::determine(key, root);
-        std::vector<std::string> intvArr = utils::splitString(intv," ");
-        
-        //is this always size 2? These python std::string functions aren't very nice at all
-        //write a Interval::getRoman
-        std::string interval_type = intvArr[0];
-        std::string interval = intvArr[1];
-        std::string func="";
-        
-        if(interval == "unison"){
-            func = "I";
-        }else if(interval == "second"){
-            func = "II";//was lower, but I don't think it makes sense since a song can be said to be in F lydian and then ii is not minor but G mixo. Also just harder to read since ii seems to indicate minor, but isn't necesarily, eg. Im7 iiM7
-        }else if(interval == "third"){
-            func = "III";//was lower
-        }else if(interval == "fourth"){
-            func = "IV";
-        }else if(interval == "fifth"){
-            func = "V";
-        }else if(interval == "sixth"){
-            func = "VI";//was lower
-        }else if(interval == "seventh"){
-            func = "VII";//was lower
-        }
-        
-        
-        if(shorthand){
-            func += chord_type;
-        }else{
-            func = func_dict[func] + Chord::getFullName(chord_type);
-        }
+        RomanFunction function = RomanNumeral::fromSpelling(key->name, root);
+        function.symbol = symbol;
+        return Progression::getFunctionInRoman(function, shorthand);
+    }
     
-        /*
+    /*
+     Function of a chord given as numbers: any two pitches for key and root,
+     only their pitch classes count, and a Chord::getSymbolId. Allocates
+     nothing. Without spelling to go by the root is named as Interval::toRoman
+     does, eg. 3 semitones up is bIII.
+     {{{
+     >>> Progression::getFunction(60, 63, Chord::getSymbolId("m7"))
+     degree 2, accidentals -1 (bIIIm7)
+     }}}
+     */
+    static RomanFunction getFunction(int keyPitch, int rootPitch, int symbol){
+        RomanFunction function = RomanNumeral::fromSemitones(rootPitch - keyPitch);
+        function.symbol = symbol;
+        function.valid = symbol >= 0;
+        return function;
+    }
     
-         
-        std::vector<std::string> M = {"M","M7"};
-        std::vector<std::string> m = {"m","m7"};
-        std::vector<std::string> M7 = {"M","7"};
-        std::vector<std::string> dim = {"dim","m7b5"};
-        
-        std::map<std::string, std::vector<std::string> > expected_chord = {
-        {"I",M},
-        {"IV",M},
-        {"II",m},
-        {"III",m},
-        {"VI",m},
-        {"VII",m},
-        {"V",M7},
-        {"VII",dim}
-        };
-
-
-        
-        //Check whether the chord is altered or not
-        typedef std::map<std::string, std::vector<std::string> >::iterator it_type;
-        for(it_type iterator = expected_chord.begin(); iterator != expected_chord.end(); iterator++) {
-            if(iterator->first == func){
-                
-                //Triads
-                if(chord_type == iterator->second[0]){
-                    if (!shorthand){
-                        func = func_dict[func];
-                    }
-                    //Sevenths
-                }else if(chord_type == iterator->second[1]){
-                    if (shorthand){
-                        func += "7";
-                    }else{
-                        func = func_dict[func] + " seventh";
-                    }
-                    //Other
-                }else{
-                    if(shorthand){
-                        func += chord_type;
-                    }else{
-                        func = func_dict[func] + Chord::getFullName(chord_type);
-                    }
-                }
-            }
+    static std::string getFunctionInRoman(int keyPitch, int rootPitch, int symbol, bool shorthand = true){
+        return Progression::getFunctionInRoman(Progression::getFunction(keyPitch, rootPitch, symbol), shorthand);
+    }
+    
+    /*
+     Text for a RomanFunction, eg. "bIIIm7", or "minor mediant minor seventh"
+     without shorthand.
+     */
+    static std::string getFunctionInRoman(const RomanFunction& function, bool shorthand = true){
+        if(!function.valid || function.symbol < 0){
+            return "";
         }
-        
-        */
-        
-        
-        //Handle b's and #'s (for instance Dbm in key C is bII)
-        if (shorthand){
-            if (interval_type == "minor"){
-                func = "b" + func;
-            }else if( interval_type == "augmented"){
-                func = "#" + func;
-            }else if( interval_type == "diminished"){
-                func = "bb" + func;
-            }
+        const std::string& symbol = Chord::getSymbol(function.symbol);
+        std::string func;
+        if(shorthand){
+            func.append(RomanNumeral::getPrefix(function.accidentals));
+            func.append(RomanNumeral::getNumeral(function.degree));
+            func.append(symbol);
         }else{
-            if (interval_type == "minor"){
-                func = "minor " + func;
-            }else if( interval_type == "augmented"){
-                func = "augmented " + func;
-            }else if( interval_type == "diminished"){
-                func = "diminished " + func;
-            }
+            func.append(RomanNumeral::getQualityName(function.accidentals));
+            func.append(RomanNumeral::getFunctionName(function.degree));
+            func.append(Chord::getFullName(symbol));
         }
-        
-        
-        //std::cout<<"Interval: "<<interval_type<<" "<<interval<<" key: "<<key<<" root: "<<root<<" function: "<<func<<" symbol: " <<chord_type<<std::endl;
-        
         return func;
     }
     
@@ -1127,6 +1119,122 @@ class Progression : public std::enable_shared_from_this<Progression> {
     
 private:
     
+    /*
+     One chord of a progression, from the analysis cache when an equivalent
+     chord has been seen in any key before.
+     */
+    static ChordAnalysis analyseName(const std::string& chordName, NotePtr key, bool shorthand, bool useInversions, bool usePoly){
+        ChordForm form;
+        uint64_t id = 0;
+        bool cacheable = !useInversions && !usePoly && Progression::getChordForm(chordName, key, form);
+        if(cacheable){
+            id = form.getId(shorthand);
+            ChordAnalysis cached;
+            if(Progression::getAnalysisCache().get(id, cached)){
+                MUSICTHEORY_COUNT(InstrumentCounter::AnalysisCacheHit);
+                return cached;
+            }
+            MUSICTHEORY_COUNT(InstrumentCounter::AnalysisCacheMiss);
+        }
+        
+        ChordReading reading = Progression::read(chordName, useInversions, usePoly);
+        ChordAnalysis analysis(reading.chord != nullptr, std::vector<std::string>());
+        if(reading.chord){
+            analysis.second = Progression::label(reading, key, shorthand);
+        }
+#ifdef LOGS
+        else
+        {
+            ofLogWarning()<<__FUNCTION__<<" "<<chordName<<" not valid"<<std::endl;
+        }
+#endif // LOGS
+        
+        //chords Chord::determine has no name for are left out, they warn every time
+        if(cacheable && reading.chord && reading.names.size()){
+            Progression::getAnalysisCache().put(id, analysis);
+        }
+        return analysis;
+    }
+    
+    //letter 0-6 from C and pitch class of eg. "Bb"
+    static bool readPitch(std::string_view note, int& letter, int& pitch){
+        static const int letterPitch[7] = { 0, 2, 4, 5, 7, 9, 11 };
+        if(note.empty() || note.size() > 2 || note[0] < 'A' || note[0] > 'G'){
+            return false;
+        }
+        letter = (note[0] - 'A' + 5) % 7;
+        pitch = letterPitch[letter];
+        if(note.size() == 2){
+            if(note[1] != '#' && note[1] != 'b'){
+                return false;
+            }
+            pitch += note[1] == '#' ? 1 : -1;
+        }
+        return pitch >= 0 && pitch < 12;
+    }
+    
+    /*
+     Roman numerals for a name as Chord::determine writes it: polychords as
+     top|bottom, slash chords as chord/bass.
+     */
+    static std::string labelName(const std::string& chordStr, NotePtr key, bool shorthand){
+        size_t bar = chordStr.find('|');
+        if(bar != std::string::npos && chordStr.find('|', bar + 1) == std::string::npos){
+            std::string top = chordStr.substr(0, bar);
+            std::string bottom = chordStr.substr(bar + 1);
+            if(top != bottom){
+                return Progression::getFunctionInRoman(top,key,shorthand) + "|" + Progression::getFunctionInRoman(bottom,key,shorthand);
+            }
+        }
+        if(Progression::isSlashName(chordStr)){
+            size_t slash = chordStr.find('/');
+            std::string bass = chordStr.substr(slash + 1, chordStr.find('/', slash + 1) - slash - 1);
+            return Progression::getFunctionInRoman(chordStr.substr(0, slash),key,shorthand) + "/" + Progression::getFunctionInRoman(bass,key,shorthand);
+        }
+        return Progression::getFunctionInRoman(chordStr,key,shorthand);
+    }
+    
+    /*
+     Roman numerals for a name as the user wrote it, where any single slash
+     splits it, eg. C6/9 is read as C6 over 9.
+     */
+    static std::string labelWritten(const std::string& chordName, NotePtr key, bool shorthand){
+        std::vector<std::string> slash = utils::splitString(chordName, "/");//different bass
+        std::vector<std::string> poly = utils::splitString(chordName, "|");//combined chords
+        if(poly.size()==2 && poly[0]!=poly[1]){
+            return Progression::getFunctionInRoman(poly[0],key,shorthand) + "|" + Progression::getFunctionInRoman(poly[1],key,shorthand);
+        }else if(slash.size()==2){
+            return Progression::getFunctionInRoman(slash[0],key,shorthand) + "/" + Progression::getFunctionInRoman(slash[1],key,shorthand);
+        }
+        return Progression::getFunctionInRoman(chordName,key,shorthand);
+    }
+    
+    //same answer as Chord::isSlashChord, a / followed by a note letter, without compiling a regex
+    static bool isSlashName(const std::string& chordStr){
+        for(size_t i=0;i + 1<chordStr.size();i++){
+            char c = chordStr[i + 1];
+            if(chordStr[i] == '/' && ((c >= 'a' && c <= 'g') || (c >= 'A' && c <= 'G'))){
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /*
+     The chord on top of a polychord or over a slash bass, read the way
+     Chord::fromShorthand does, eg. "C7" from "C7/E" but all of "C6/9".
+     */
+    static std::string getTopChord(const std::string& chordStr){
+        size_t bar = chordStr.find('|');
+        if(bar != std::string::npos && chordStr.find('|', bar + 1) == std::string::npos){
+            return chordStr.substr(0, bar);
+        }
+        if(Progression::isSlashName(chordStr)){
+            return chordStr.substr(0, chordStr.find('/'));
+        }
+        return chordStr;
+    }
+    
     /*
      It just wacks the accidentals back unto the std::string as normal b or # symbols
      */
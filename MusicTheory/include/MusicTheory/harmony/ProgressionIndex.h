@@ -0,0 +1,554 @@
+/*
+ *  ProgressionIndex.h
+ *  MusicTheory
+ *
+ *  Finds progressions like a given one in a large corpus. Each progression
+ *  becomes a list of tokens, one per chord: its root in semitones above the
+ *  key and the interval signature of its symbol, so IIm7 and iim7, or M7
+ *  and Maj7, are the same token. Runs of gramSize tokens are hashed with
+ *  their roots measured from the first root of the run, so a ii-V-I hashes
+ *  the same in any key and whatever key the analysis assumed.
+ *
+ *  {{{
+ *  std::vector<std::vector<uint16_t>> corpus;
+ *  corpus.push_back(ProgressionIndex::tokenize(Progression::analyse("Dm7,G7,CM7", "C")));
+ *  corpus.push_back(ProgressionIndex::tokenize("Cm7,F7,BbM7,EbM7", "Bb"));
+ *  ProgressionIndex::write(corpus, "corpus.mtpi");
+ *
+ *  ProgressionIndex index;
+ *  index.open("corpus.mtpi");
+ *  index.search(ProgressionIndex::tokenize("IIm7,V7,IM7"), 10) -> [{id 0, ...}, {id 1, ...}]
+ *  }}}
+ *
+ *  The index is an inverted file: sorted gram hashes, and for each the
+ *  sorted ids of the progressions holding it. write builds it with one
+ *  worker per core. open maps the file into memory instead of reading
+ *  it, checking only the offsets, so opening is quick and the pages the
+ *  queries touch are shared by every process using the same file.
+ *  Posting ids are checked as a search reads them, so a corrupt file
+ *  gives wrong matches but never reads out of bounds. A search reads one posting list
+ *  per gram of the query and, in corpora of more than a hundred
+ *  progressions, skips grams that are in too many of them to tell them
+ *  apart, eg. I,IV,V in a pop corpus.
+ *
+ *  File layout, little endian, every array 8 byte aligned:
+ *  header, uint64 hashes[grams], uint64 offsets[grams + 1],
+ *  uint32 postings[offsets[grams]], uint32 lengths[progressions].
+ *
+ */
+
+#ifndef _ProgressionIndex
+#define _ProgressionIndex
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "Chord.h"
+#include "Progression.h"
+#include "RomanNumeral.h"
+
+namespace MusicTheory{
+
+	struct ProgressionIndexSettings {
+		int gramSize = 3;					//chords per gram, used by write, search uses the index's own
+		int threads = 0;					//for write, 0 = std::thread::hardware_concurrency()
+		float maxGramFrequency = 0.02;		//search skips grams in more than this share of the progressions
+		int minProgressionsToSkip = 100;	//in corpora up to this size search skips no grams
+	};
+
+
+	struct ProgressionMatch {
+		uint32_t id = 0;		//position of the progression in the corpus written
+		float score = 0;		//0-1, see search
+		int grams = 0;			//grams in common
+	};
+
+
+
+class ProgressionIndex {
+
+  public:
+
+	ProgressionIndex(ProgressionIndexSettings _settings = ProgressionIndexSettings()) {
+		settings = _settings;
+	}
+
+	~ProgressionIndex() {
+		close();
+	}
+
+	ProgressionIndex(const ProgressionIndex&) = delete;
+	ProgressionIndex& operator=(const ProgressionIndex&) = delete;
+
+
+	/*
+	 One token per chord, from roman numerals as Progression::analyse or
+	 quickAnalysis give them, eg. "IIm7", "bVII", "ii". 0 for a chord that
+	 could not be read, eg. "?" or a polychord. A slash bass is ignored.
+	 */
+	static std::vector<uint16_t> tokenize(const std::vector<std::string>& numerals) {
+		std::vector<uint16_t> tokens;
+		tokens.reserve(numerals.size());
+		for (const std::string& numeral : numerals) {
+			tokens.push_back(ProgressionIndex::getNumeralToken(numeral));
+		}
+		return tokens;
+	}
+
+	//the first reading of each chord of Progression::analyse
+	static std::vector<uint16_t> tokenize(const std::vector<std::vector<std::string>>& analysis) {
+		std::vector<uint16_t> tokens;
+		tokens.reserve(analysis.size());
+		for (const std::vector<std::string>& readings : analysis) {
+			tokens.push_back(readings.size() ? ProgressionIndex::getNumeralToken(readings.front()) : 0);
+		}
+		return tokens;
+	}
+
+	//comma separated roman numerals, eg. "IIm7,V7,IM7"
+	static std::vector<uint16_t> tokenize(const std::string& numerals) {
+		return ProgressionIndex::tokenize(utils::splitString(numerals, ","));
+	}
+
+	/*
+	 Comma separated chord names in a key, eg. "Dm7,G7,CM7" in "C", read
+	 with Progression::getChordForm, no analysis needed.
+	 */
+	static std::vector<uint16_t> tokenize(const std::string& chordNames, const std::string& key) {
+		std::vector<uint16_t> tokens;
+		NotePtr keyNote = Note::create(key);
+		for (const std::string& name : utils::splitString(chordNames, ",")) {
+			Progression::ChordForm form;
+			uint16_t token = 0;
+			if (Progression::getChordForm(name, keyNote, form)) {
+				token = ProgressionIndex::getToken(form.semitones, Chord::getVocabulary().getSignature(form.symbol));
+			}
+			tokens.push_back(token);
+		}
+		return tokens;
+	}
+
+	//root in the low 4 bits, interval signature above, 0 if either is unknown
+	static uint16_t getToken(int semitones, int signature) {
+		if (signature <= 0) {
+			return 0;
+		}
+		return (uint16_t)((((semitones % 12) + 12) % 12) | ((signature & 0xFFF) << 4));
+	}
+
+	static uint16_t getNumeralToken(const std::string& numeral) {
+		if (numeral.find('|') != std::string::npos) {
+			return 0;
+		}
+		std::string_view str(numeral);
+		size_t slash = str.find('/');
+		if (slash != std::string_view::npos) {
+			str = str.substr(0, slash);
+		}
+		RomanToken token = RomanNumeral::tokenize(str);
+		if (!token.valid) {
+			return 0;
+		}
+		std::string suffix(token.suffix);
+		if (token.lowercase && (!suffix.size() || std::string("mdo+as").find(suffix[0]) == std::string::npos)) {
+			suffix = "m" + suffix;//ii7 is IIm7
+		}
+		if (!suffix.size()) {
+			suffix = "M";
+		}
+		return ProgressionIndex::getToken(token.semitones(), Chord::getVocabulary().getSignature(Chord::getSymbolId(suffix)));
+	}
+
+	/*
+	 Hashes of every run of gramSize tokens, sorted and without repeats.
+	 Runs with an unknown token are left out. A progression shorter than
+	 gramSize is one gram of its own length.
+	 */
+	static std::vector<uint64_t> getGrams(const std::vector<uint16_t>& tokens, int gramSize) {
+		std::vector<uint64_t> grams;
+		if (!tokens.size()) {
+			return grams;
+		}
+		int n = std::min(std::max(1, gramSize), (int)tokens.size());
+		for (int i = 0; i + n <= (int)tokens.size(); i++) {
+			uint64_t hash = 0xcbf29ce484222325ull ^ (uint64_t)n;
+			int base = tokens[i] & 15;
+			bool known = true;
+			for (int j = i; j < i + n && known; j++) {
+				known = tokens[j] != 0;
+				int relative = (((tokens[j] & 15) - base) + 12) % 12;
+				hash = (hash ^ (uint64_t)((tokens[j] & ~15) | relative)) * 0x100000001b3ull;
+			}
+			if (known) {
+				//FNV leaves the high bits, which the shards of write use, poorly mixed
+				hash ^= hash >> 33;
+				hash *= 0xff51afd7ed558ccdull;
+				hash ^= hash >> 33;
+				grams.push_back(hash);
+			}
+		}
+		std::sort(grams.begin(), grams.end());
+		grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+		return grams;
+	}
+
+
+	/*
+	 Builds the index of progressions and writes it to path. A
+	 progression's id is its position in progressions.
+	 */
+	static bool write(const std::vector<std::vector<uint16_t>>& progressions, const std::string& path, ProgressionIndexSettings settings = ProgressionIndexSettings()) {
+		int threads = settings.threads > 0 ? settings.threads : std::max(1, (int)std::thread::hardware_concurrency());
+		int gramSize = std::max(1, settings.gramSize);
+
+		//each worker takes a slice of the corpus and sorts its grams into shards by the top hash bits
+		const int SHARDS = 256;
+		typedef std::pair<uint64_t, uint32_t> Posting;
+		std::vector<std::vector<std::vector<Posting>>> buckets(threads, std::vector<std::vector<Posting>>(SHARDS));
+		std::vector<uint32_t> lengths(progressions.size());
+		std::vector<std::future<void>> jobs;
+		size_t slice = (progressions.size() + threads - 1) / threads;
+		for (int w = 0; w < threads; w++) {
+			jobs.push_back(std::async(std::launch::async, [&, w]() {
+				size_t end = std::min(progressions.size(), (w + 1) * slice);
+				for (size_t i = w * slice; i < end; i++) {
+					std::vector<uint64_t> grams = ProgressionIndex::getGrams(progressions[i], gramSize);
+					lengths[i] = (uint32_t)grams.size();
+					for (uint64_t g : grams) {
+						buckets[w][g >> 56].push_back(Posting(g, (uint32_t)i));
+					}
+				}
+			}));
+		}
+		for (int j = 0; j < (int)jobs.size(); j++) {
+			jobs[j].get();
+		}
+		jobs.clear();
+
+		//then each shard is gathered and sorted on its own, in shard order they are sorted overall
+		std::vector<std::vector<Posting>> shards(SHARDS);
+		std::atomic<int> next(0);
+		for (int w = 0; w < threads; w++) {
+			jobs.push_back(std::async(std::launch::async, [&]() {
+				for (int s = next++; s < SHARDS; s = next++) {
+					for (int b = 0; b < threads; b++) {
+						shards[s].insert(shards[s].end(), buckets[b][s].begin(), buckets[b][s].end());
+						std::vector<Posting>().swap(buckets[b][s]);
+					}
+					std::sort(shards[s].begin(), shards[s].end());
+				}
+			}));
+		}
+		for (int j = 0; j < (int)jobs.size(); j++) {
+			jobs[j].get();
+		}
+
+		std::vector<uint64_t> hashes;
+		std::vector<uint64_t> offsets;
+		std::vector<uint32_t> postings;
+		for (const std::vector<Posting>& shard : shards) {
+			for (size_t i = 0; i < shard.size(); i++) {
+				if (!i || shard[i].first != shard[i - 1].first) {
+					hashes.push_back(shard[i].first);
+					offsets.push_back(postings.size());
+				}
+				postings.push_back(shard[i].second);
+			}
+		}
+		offsets.push_back(postings.size());
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+#ifdef LOGS
+			ofLogError() << "ProgressionIndex::write can't open " << path << std::endl;
+#endif // LOGS
+			return false;
+		}
+		Header header;
+		header.gramSize = gramSize;
+		header.progressions = progressions.size();
+		header.grams = hashes.size();
+		header.postings = postings.size();
+		uint64_t zero = 0;
+		file.write((const char*)&header, sizeof(Header));
+		file.write((const char*)hashes.data(), hashes.size() * sizeof(uint64_t));
+		file.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+		file.write((const char*)postings.data(), postings.size() * sizeof(uint32_t));
+		file.write((const char*)&zero, (postings.size() % 2) * sizeof(uint32_t));
+		file.write((const char*)lengths.data(), lengths.size() * sizeof(uint32_t));
+		return (bool)file;
+	}
+
+
+	/*
+	 Maps an index written by write. False if the file is missing or is
+	 not an index.
+	 */
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		HANDLE mapping = NULL;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		}
+		CloseHandle(file);
+		if (!mapping) {
+			return false;
+		}
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!view) {
+			return false;
+		}
+		mapped = view;
+		mappedSize = (size_t)fileSize.QuadPart;
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat info;
+		void* view = MAP_FAILED;
+		if (fstat(file, &info) == 0 && info.st_size > 0) {
+			view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+		}
+		::close(file);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		mapped = view;
+		mappedSize = (size_t)info.st_size;
+#endif
+		if (!attach((const char*)mapped, mappedSize)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 Uses an index already in memory, eg. read from elsewhere. The data
+	 is not copied and must outlive the index.
+	 */
+	bool open(const char* data, size_t size) {
+		close();
+		return attach(data, size);
+	}
+
+	void close() {
+		if (mapped) {
+#ifdef _WIN32
+			UnmapViewOfFile(mapped);
+#else
+			munmap((void*)mapped, mappedSize);
+#endif
+		}
+		mapped = nullptr;
+		mappedSize = 0;
+		header = nullptr;
+		hashes = nullptr;
+		offsets = nullptr;
+		postings = nullptr;
+		lengths = nullptr;
+	}
+
+	bool isOpen() const {
+		return header != nullptr;
+	}
+
+	//progressions indexed
+	size_t size() const {
+		return header ? (size_t)header->progressions : 0;
+	}
+
+	int getGramSize() const {
+		return header ? (int)header->gramSize : 0;
+	}
+
+
+	/*
+	 The count progressions sharing the most grams with tokens, best first.
+	 The score is the geometric mean of the share of the query's grams
+	 found, each weighted by how rare it is, and the share of the
+	 progression's grams that were matched. Grams of the query missing
+	 from the index weigh as much as the rarest, skipped ones count as
+	 not found. A progression scores 1 against itself when none of its
+	 grams are skipped.
+	 */
+	std::vector<ProgressionMatch> search(const std::vector<uint16_t>& tokens, int count = 10) const {
+		std::vector<ProgressionMatch> result;
+		if (!header || count <= 0) {
+			return result;
+		}
+		std::vector<uint64_t> grams = ProgressionIndex::getGrams(tokens, (int)header->gramSize);
+		if (!grams.size()) {
+			return result;
+		}
+		double total = (double)header->progressions;
+		uint64_t maxPostings = std::max<uint64_t>(1, (uint64_t)(settings.maxGramFrequency * total));
+		if (header->progressions <= (uint64_t)std::max(0, settings.minProgressionsToSkip)) {
+			maxPostings = header->progressions;
+		}
+		float missingWeight = (float)std::log(1.0 + total);
+
+		//scores per progression, kept between searches on the same thread and cleared through touched
+		thread_local std::vector<float> scores;
+		thread_local std::vector<uint16_t> shared;
+		thread_local std::vector<uint32_t> touched;
+		if (scores.size() < header->progressions) {
+			scores.assign(header->progressions, 0);
+			shared.assign(header->progressions, 0);
+		}
+		touched.clear();
+
+		float queryWeight = 0;//of every gram of the query, found or not
+		for (uint64_t g : grams) {
+			const uint64_t* end = hashes + header->grams;
+			const uint64_t* found = std::lower_bound(hashes, end, g);
+			if (found == end || *found != g) {
+				queryWeight += missingWeight;
+				continue;
+			}
+			size_t i = found - hashes;
+			uint64_t begin = offsets[i];
+			uint64_t size = offsets[i + 1] - begin;
+			float weight = (float)std::log(1.0 + total / size);
+			queryWeight += weight;
+			if (size > maxPostings) {
+				continue;
+			}
+			for (const uint32_t* p = postings + begin; p != postings + begin + size; p++) {
+				if (*p >= header->progressions) {
+					continue;//corrupt file
+				}
+				if (!shared[*p]) {
+					touched.push_back(*p);
+				}
+				scores[*p] += weight;
+				shared[*p]++;
+			}
+		}
+
+		result.reserve(touched.size());
+		for (uint32_t id : touched) {
+			ProgressionMatch m;
+			m.id = id;
+			m.grams = shared[id];
+			float ofQuery = queryWeight > 0 ? scores[id] / queryWeight : 0;
+			float ofProgression = (float)shared[id] / std::max<uint32_t>(1, lengths[id]);
+			m.score = std::sqrt(ofQuery * ofProgression);
+			result.push_back(m);
+			scores[id] = 0;
+			shared[id] = 0;
+		}
+		auto better = [](const ProgressionMatch& a, const ProgressionMatch& b) {
+			return a.score != b.score ? a.score > b.score : a.id < b.id;
+		};
+		if (result.size() > (size_t)count) {
+			std::partial_sort(result.begin(), result.begin() + count, result.end(), better);
+			result.resize(count);
+		}
+		else {
+			std::sort(result.begin(), result.end(), better);
+		}
+		return result;
+	}
+
+	ProgressionIndexSettings& getSettings() {
+		return settings;
+	}
+
+
+  private:
+
+	struct Header {
+		char magic[4] = { 'M', 'T', 'P', 'I' };
+		uint32_t version = 1;
+		uint32_t gramSize = 3;
+		uint32_t reserved = 0;
+		uint64_t progressions = 0;
+		uint64_t grams = 0;
+		uint64_t postings = 0;
+	};
+
+	//checks the sizes add up before pointing into data
+	bool attach(const char* data, size_t size) {
+		if (!data || size < sizeof(Header) || std::memcmp(data, "MTPI", 4) != 0) {
+			return false;
+		}
+		const Header* h = (const Header*)data;
+		if (h->version != 1) {
+			return false;
+		}
+		//bounded first so the size sum below cannot overflow
+		if (h->grams > size / sizeof(uint64_t) || h->postings > size / sizeof(uint32_t) || h->progressions > size / sizeof(uint32_t)) {
+			return false;
+		}
+		uint64_t postingBytes = (h->postings + h->postings % 2) * sizeof(uint32_t);
+		uint64_t expected = sizeof(Header) + h->grams * sizeof(uint64_t) + (h->grams + 1) * sizeof(uint64_t) + postingBytes + h->progressions * sizeof(uint32_t);
+		if (expected != size) {
+			return false;
+		}
+		const char* at = data + sizeof(Header);
+		hashes = (const uint64_t*)at;
+		at += h->grams * sizeof(uint64_t);
+		offsets = (const uint64_t*)at;
+		at += (h->grams + 1) * sizeof(uint64_t);
+		postings = (const uint32_t*)at;
+		at += postingBytes;
+		lengths = (const uint32_t*)at;
+		//every posting list inside postings
+		if (offsets[0] != 0 || offsets[h->grams] != h->postings) {
+			return false;
+		}
+		for (uint64_t i = 0; i < h->grams; i++) {
+			if (offsets[i] > offsets[i + 1]) {
+				return false;
+			}
+		}
+		header = h;
+		return true;
+	}
+
+	ProgressionIndexSettings settings;
+	const void* mapped = nullptr;
+	size_t mappedSize = 0;
+	const Header* header = nullptr;
+	const uint64_t* hashes = nullptr;
+	const uint64_t* offsets = nullptr;
+	const uint32_t* postings = nullptr;
+	const uint32_t* lengths = nullptr;
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,583 @@
+/*
+ *  ProgressionPatterns.h
+ *  MusicTheory
+ *
+ *  Finds harmonic patterns, cadences, ii-V-Is, turnarounds and so on, in
+ *  analysed progressions. Any number of patterns are compiled together
+ *  into one automaton that reads each chord once, however many patterns
+ *  there are.
+ *
+ *  {{{
+ *  ProgressionPatterns patterns;
+ *  patterns.add("ii-V-I", "IIm7,V7,I", true);
+ *  patterns.add("backdoor", "IVm,bVII7,I");
+ *  patterns.scan(Progression::analyse("Em7,A7,DM7,Fm,Bb7,C", "C"))
+ *  -> [{pattern 0, start 0, end 3}, {pattern 1, start 3, end 6}]
+ *  }}}
+ *
+ *  A pattern is a comma separated list of chords in roman numerals:
+ *
+ *  V7          numeral and symbol. The symbol stands for its ChordFamily,
+ *              so V7 also matches V9 and V7#9, IIm7 matches IIm.
+ *  V, ii       no symbol: major or dominant in capitals, minor in lowercase
+ *  V*          any chord on V
+ *  ?7          any root with that symbol
+ *  ?           any chord at all
+ *  V7|bII7     either
+ *  *           any number of chords, none included
+ *
+ *  Numerals are relative to the key of the analysis. Patterns added with
+ *  anyKey match in all 12 transpositions, so "IIm7,V7,I" also finds
+ *  IIIm7,VI7,II, a ii-V-I of the supertonic.
+ *
+ *  The patterns make one nondeterministic automaton. It is turned into a
+ *  deterministic one lazily while scanning, a state at a time, and the
+ *  states are kept, so after a few progressions scanning is a table look
+ *  up per chord. At most maxStates are kept. Past that the cache starts
+ *  over, so a huge pattern set still scans, just slower.
+ *
+ */
+
+#ifndef _ProgressionPatterns
+#define _ProgressionPatterns
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chord.h"
+#include "ChordSignature.h"
+#include "Progression.h"
+#include "ProgressionIndex.h"
+#include "RomanNumeral.h"
+
+namespace MusicTheory{
+
+	struct ProgressionPatternSettings {
+		int maxStates = 10000;		//deterministic states kept before the cache starts over
+	};
+
+
+	struct ProgressionPatternMatch {
+		int pattern = 0;		//index, the order of add
+		int start = 0;			//first chord
+		int end = 0;			//one past the last chord
+	};
+
+
+
+class ProgressionPatterns {
+
+  public:
+
+	//chord classes read: 12 roots times the ChordFamily values, and one for chords that could not be read
+	static const int FAMILIES = 9;
+	static const int SYMBOLS = 12 * FAMILIES + 1;
+	static const int UNKNOWN = SYMBOLS - 1;
+
+	ProgressionPatterns(ProgressionPatternSettings _settings = ProgressionPatternSettings()) {
+		settings = _settings;
+		compiled = std::make_shared<Compiled>();
+	}
+
+	/*
+	 Copies share the patterns but not the cache of states, so give each
+	 thread its own copy to scan with.
+	 */
+	ProgressionPatterns(const ProgressionPatterns& other) {
+		settings = other.settings;
+		compiled = other.compiled;
+	}
+
+	ProgressionPatterns& operator=(const ProgressionPatterns& other) {
+		settings = other.settings;
+		compiled = other.compiled;
+		starts.clear();
+		clearStates();
+		return *this;
+	}
+
+
+	/*
+	 Adds a pattern, see the top of the file. Returns its index, or -1 if
+	 it can't be read.
+	 */
+	int add(const std::string& name, const std::string& pattern, bool anyKey = false) {
+		std::vector<Item> items;
+		for (std::string element : utils::splitString(pattern, ",")) {
+			element.erase(std::remove(element.begin(), element.end(), ' '), element.end());
+			Item item;
+			if (element == "*") {
+				if (items.size() && items.back().gap) {
+					continue;//one gap is as good as two
+				}
+				item.gap = true;
+			}
+			else {
+				for (const std::string& alternative : utils::splitString(element, "|")) {
+					Symbols s;
+					if (!ProgressionPatterns::readElement(alternative, s)) {
+#ifdef LOGS
+						ofLogError() << "ProgressionPatterns::add can't read " << alternative << " in " << pattern << std::endl;
+#endif // LOGS
+						return -1;
+					}
+					item.symbols |= s;
+				}
+			}
+			items.push_back(item);
+		}
+		//gaps at the ends change nothing, matches are searched for everywhere
+		while (items.size() && items.front().gap) {
+			items.erase(items.begin());
+		}
+		while (items.size() && items.back().gap) {
+			items.pop_back();
+		}
+		if (!items.size()) {
+			return -1;
+		}
+
+		//a private copy, other copies of this set keep the patterns they had
+		std::shared_ptr<Compiled> c = std::make_shared<Compiled>(*compiled);
+		int index = (int)c->names.size();
+		c->names.push_back(name);
+		c->copies.push_back(std::vector<int>());
+		for (int t = 0; t < (anyKey ? 12 : 1); t++) {
+			Chain chain;
+			chain.pattern = index;
+			for (const Item& item : items) {
+				Item moved = item;
+				if (!item.gap) {
+					moved.symbols = ProgressionPatterns::transpose(item.symbols, t);
+				}
+				chain.items.push_back(moved);
+			}
+			bool same = false;
+			for (int other : c->copies[index]) {
+				same = same || c->chains[other].items == chain.items;
+			}
+			if (!same) {
+				c->copies[index].push_back((int)c->chains.size());
+				chain.first = c->states;
+				c->states += (int)chain.items.size();
+				c->owners.insert(c->owners.end(), chain.items.size(), (int)c->chains.size());
+				c->chains.push_back(chain);
+			}
+		}
+		compiled = c;
+		starts.clear();
+		clearStates();
+		return index;
+	}
+
+	int size() const {
+		return (int)compiled->names.size();
+	}
+
+	const std::string& getName(int pattern) const {
+		return compiled->names[pattern];
+	}
+
+
+	/*
+	 Every match in a progression, ordered by where it ends. Patterns of
+	 variable length report their shortest match, found by reading back
+	 from its end, so a gap spanning a long stretch costs that stretch.
+	 */
+	std::vector<ProgressionPatternMatch> scan(const std::vector<int>& symbols) {
+		std::vector<ProgressionPatternMatch> result;
+		int state = 0;
+		for (int i = 0; i < (int)symbols.size(); i++) {
+			state = step(state, symbols[i]);
+			for (int pattern : states[state].accepts) {
+				ProgressionPatternMatch m;
+				m.pattern = pattern;
+				m.end = i + 1;
+				m.start = findStart(pattern, states[state].chains, symbols, m.end);
+				result.push_back(m);
+			}
+		}
+		return result;
+	}
+
+	//the first reading of each chord of Progression::analyse or determine
+	std::vector<ProgressionPatternMatch> scan(const std::vector<std::vector<std::string>>& analysis) {
+		std::vector<int> symbols;
+		symbols.reserve(analysis.size());
+		for (const std::vector<std::string>& readings : analysis) {
+			symbols.push_back(readings.size() ? ProgressionPatterns::getSymbol(ProgressionIndex::getNumeralToken(readings.front())) : UNKNOWN);
+		}
+		return scan(symbols);
+	}
+
+	std::vector<ProgressionPatternMatch> scan(const std::vector<uint16_t>& tokens) {
+		std::vector<int> symbols;
+		symbols.reserve(tokens.size());
+		for (uint16_t token : tokens) {
+			symbols.push_back(ProgressionPatterns::getSymbol(token));
+		}
+		return scan(symbols);
+	}
+
+	//comma separated roman numerals, eg. "IIm7,V7,IM7"
+	std::vector<ProgressionPatternMatch> scan(const std::string& numerals) {
+		return scan(ProgressionIndex::tokenize(numerals));
+	}
+
+	//comma separated chord names in a key, no analysis needed
+	std::vector<ProgressionPatternMatch> scan(const std::string& chordNames, const std::string& key) {
+		return scan(ProgressionIndex::tokenize(chordNames, key));
+	}
+
+
+	/*
+	 For chords arriving one at a time. Start from state 0 and feed each
+	 chord's symbol, getAccepted then lists the patterns ending on it.
+	 */
+	int step(int state, int symbol) {
+		if (symbol < 0 || symbol >= SYMBOLS) {
+			symbol = UNKNOWN;
+		}
+		if (!states.size()) {
+			addState(std::vector<int>());
+		}
+		int next = states[state].next[symbol];
+		if (next >= 0) {
+			return next;
+		}
+		std::vector<int> to = move(states[state].nfa, symbol);
+		if ((int)states.size() >= std::max(2, settings.maxStates)) {
+			//start over, states handed out before are no longer valid, so only the new one is kept
+			clearStates();
+			addState(std::vector<int>());
+			return addState(to);
+		}
+		next = findState(to);
+		states[state].next[symbol] = next;
+		return next;
+	}
+
+	const std::vector<int>& getAccepted(int state) const {
+		static const std::vector<int> none;
+		return state >= 0 && state < (int)states.size() ? states[state].accepts : none;
+	}
+
+	ProgressionPatternSettings& getSettings() {
+		return settings;
+	}
+
+	//deterministic states built so far
+	int getStateCount() const {
+		return (int)states.size();
+	}
+
+
+	//chord class of a ProgressionIndex token
+	static int getSymbol(uint16_t token) {
+		if (!token) {
+			return UNKNOWN;
+		}
+		int family = (int)ChordSignature::getFamily(token >> 4);
+		return (token & 15) * FAMILIES + family;
+	}
+
+	static int getSymbol(int root, ChordFamily family) {
+		return (((root % 12) + 12) % 12) * FAMILIES + (int)family;
+	}
+
+
+	/*
+	 Common cadences and progressions, names and patterns for add. They
+	 are meant for anyKey except the ones ending on I.
+	 */
+	static std::vector<std::pair<std::string, std::string>> getDefaultPatterns() {
+		return {
+			{ "ii-V-I", "IIm7,V7,I" }, { "ii-V", "IIm7,V7" }, { "minor ii-V-i", "IIm7b5,V7,Im" },
+			{ "tritone sub", "IIm7,bII7,I" }, { "backdoor", "IVm,bVII7,I" }, { "perfect", "V,I" },
+			{ "plagal", "IV,I" }, { "minor plagal", "IVm,I" }, { "deceptive", "V7,VIm" }, { "half cadence", "?,V" },
+			{ "turnaround", "I,VIm7,IIm7,V7" }, { "I-vi-ii-V", "I,VIm|VI7,IIm|II7,V7" }, { "iii-vi-ii-V", "IIIm7,VIm7,IIm7,V7" },
+			{ "V of V", "II7,V7" }, { "andalusian", "Im,bVII,bVI,V" }
+		};
+	}
+
+
+  private:
+
+	typedef std::bitset<SYMBOLS> Symbols;
+
+	struct Item {
+		Symbols symbols;
+		bool gap = false;		//any number of chords
+
+		bool operator==(const Item& other) const {
+			return gap == other.gap && symbols == other.symbols;
+		}
+	};
+
+	//one pattern in one transposition, its nondeterministic states numbered first to first + items - 1
+	struct Chain {
+		int pattern = 0;
+		int first = 0;
+		std::vector<Item> items;
+	};
+
+	struct Compiled {
+		std::vector<std::string> names;
+		std::vector<std::vector<int>> copies;	//chains of each pattern
+		std::vector<Chain> chains;
+		int states = 0;
+		std::vector<int> owners;				//chain of each nondeterministic state
+	};
+
+	struct SetHash {
+		size_t operator()(const std::vector<int>& set) const {
+			uint64_t h = 14695981039346656037ULL;
+			for (int n : set) {
+				h = (h ^ (uint32_t)n) * 1099511628211ULL;
+			}
+			return (size_t)h;
+		}
+	};
+
+	struct State {
+		std::vector<int> nfa;		//chain index and items matched, as chain.first + matched
+		std::vector<int> accepts;	//patterns ending here
+		std::vector<int> chains;	//and the chains of them that did
+		int next[SYMBOLS];			//-1 until first taken
+	};
+
+
+	static bool readElement(const std::string& element, Symbols& symbols) {
+		if (!element.size()) {
+			return false;
+		}
+		int root = -1;//any
+		std::string suffix;
+		bool lowercase = false;
+		if (element[0] == '?') {
+			suffix = element.substr(1);
+		}
+		else {
+			RomanToken token = RomanNumeral::tokenize(element);
+			if (!token.valid) {
+				return false;
+			}
+			root = ((token.semitones() % 12) + 12) % 12;
+			suffix = std::string(token.suffix);
+			lowercase = token.lowercase;
+		}
+
+		std::vector<ChordFamily> families;
+		if (root < 0 && !suffix.size()) {
+			symbols.set();//any chord, even one that could not be read
+			return true;
+		}
+		if (suffix == "*") {
+			for (int f = 0; f < FAMILIES; f++) {
+				families.push_back((ChordFamily)f);
+			}
+		}
+		else if (!suffix.size()) {
+			if (lowercase) {
+				families = { ChordFamily::Minor };
+			}
+			else {
+				families = { ChordFamily::Major, ChordFamily::Dominant };
+			}
+		}
+		else {
+			if (lowercase && std::string("mdo+as").find(suffix[0]) == std::string::npos) {
+				suffix = "m" + suffix;//ii7 is IIm7
+			}
+			int signature = Chord::getVocabulary().getSignature(Chord::getSymbolId(suffix));
+			if (signature <= 0) {
+				return false;
+			}
+			families = { ChordSignature::getFamily(signature) };
+		}
+
+		for (int r = 0; r < 12; r++) {
+			if (root < 0 || r == root) {
+				for (ChordFamily f : families) {
+					symbols.set(ProgressionPatterns::getSymbol(r, f));
+				}
+			}
+		}
+		return true;
+	}
+
+	static Symbols transpose(const Symbols& symbols, int semitones) {
+		Symbols result;
+		for (int s = 0; s < UNKNOWN; s++) {
+			if (symbols[s]) {
+				result.set(ProgressionPatterns::getSymbol(s / FAMILIES + semitones, (ChordFamily)(s % FAMILIES)));
+			}
+		}
+		result[UNKNOWN] = symbols[UNKNOWN];
+		return result;
+	}
+
+
+	/*
+	 Where the states go on symbol, every chain also trying to start on it.
+	 A state matched up to a gap both waits in the gap and tries the item
+	 after it. Chains reaching their end are put in after the states, as
+	 compiled->states + chain. The result comes out sorted from a bitmap,
+	 big pattern sets make sets of thousands.
+	 */
+	std::vector<int> move(const std::vector<int>& from, int symbol) {
+		if (!starts.size()) {
+			//where chains starting on each symbol go, so a new state only moves the ones it holds
+			starts.resize(SYMBOLS);
+			for (int s = 0; s < SYMBOLS; s++) {
+				for (const Chain& chain : compiled->chains) {
+					take(chain, 0, s, starts[s]);
+				}
+			}
+		}
+		std::vector<int> moved = starts[symbol];
+		for (int s : from) {
+			const Chain& chain = compiled->chains[compiled->owners[s]];
+			take(chain, s - chain.first, symbol, moved);
+		}
+
+		marks.assign((compiled->states + compiled->chains.size() + 63) / 64, 0);
+		for (int n : moved) {
+			marks[n >> 6] |= 1ULL << (n & 63);
+		}
+		std::vector<int> to;
+		to.reserve(moved.size());
+		for (size_t w = 0; w < marks.size(); w++) {
+			int bit = 0;
+			for (uint64_t bits = marks[w]; bits; bits >>= 1, bit++) {
+				if (bits & 1) {
+					to.push_back((int)(w * 64) + bit);
+				}
+			}
+		}
+		return to;
+	}
+
+	void take(const Chain& chain, int matched, int symbol, std::vector<int>& to) const {
+		const Item& item = chain.items[matched];
+		if (item.gap) {
+			advance(chain, matched, to);
+		}
+		else if (item.symbols[symbol]) {
+			advance(chain, matched + 1, to);
+		}
+	}
+
+	//past any gaps the item at matched may be
+	void advance(const Chain& chain, int matched, std::vector<int>& to) const {
+		if (matched == (int)chain.items.size()) {
+			to.push_back(compiled->states + (int)(&chain - compiled->chains.data()));
+			return;
+		}
+		to.push_back(chain.first + matched);
+		if (chain.items[matched].gap) {
+			to.push_back(chain.first + matched + 1);//gaps are never last
+		}
+	}
+
+	int findState(const std::vector<int>& nfa) {
+		auto found = index.find(nfa);
+		if (found != index.end()) {
+			return found->second;
+		}
+		return addState(nfa);
+	}
+
+	int addState(const std::vector<int>& set) {
+		State s;
+		for (int n : set) {
+			if (n >= compiled->states) {
+				s.chains.push_back(n - compiled->states);
+				s.accepts.push_back(compiled->chains[n - compiled->states].pattern);
+			}
+			else {
+				s.nfa.push_back(n);
+			}
+		}
+		std::sort(s.accepts.begin(), s.accepts.end());
+		s.accepts.erase(std::unique(s.accepts.begin(), s.accepts.end()), s.accepts.end());
+		std::fill(s.next, s.next + SYMBOLS, -1);
+		int id = (int)states.size();
+		index[set] = id;
+		states.push_back(s);
+		return id;
+	}
+
+	void clearStates() {
+		states.clear();
+		index.clear();
+	}
+
+
+	//latest start for which the pattern matches symbols up to end, only the chains that accepted are tried
+	int findStart(int pattern, const std::vector<int>& accepted, const std::vector<int>& symbols, int end) const {
+		int start = -1;
+		for (int c : accepted) {
+			if (compiled->chains[c].pattern == pattern) {
+				start = std::max(start, ProgressionPatterns::findStart(compiled->chains[c].items, symbols, end));
+			}
+		}
+		return std::max(start, 0);
+	}
+
+	/*
+	 Reads back from end matching the items from the last, so the first
+	 time all of them are matched is the latest start. -1 if none.
+	 */
+	static int findStart(const std::vector<Item>& items, const std::vector<int>& symbols, int end) {
+		int size = (int)items.size();
+		//reached[k]: items k and after match the symbols read so far
+		std::vector<char> reached(size + 1, 0);
+		std::vector<char> next(size + 1, 0);
+		reached[size] = 1;
+		for (int i = end - 1; i >= 0; i--) {
+			std::fill(next.begin(), next.end(), 0);
+			for (int k = size; k > 0; k--) {
+				if (!reached[k]) {
+					continue;
+				}
+				const Item& item = items[k - 1];
+				if (item.gap) {
+					next[k] = 1;//one more chord in the gap
+				}
+				else if (item.symbols[symbols[i]]) {
+					next[k - 1] = 1;
+				}
+			}
+			//past a gap for free, items are never gaps at the ends
+			for (int k = size; k > 0; k--) {
+				if (next[k] && items[k - 1].gap) {
+					next[k - 1] = 1;
+				}
+			}
+			if (next[0]) {
+				return i;
+			}
+			reached.swap(next);
+		}
+		return -1;
+	}
+
+
+	ProgressionPatternSettings settings;
+	std::shared_ptr<Compiled> compiled;
+	std::vector<std::vector<int>> starts;		//by symbol, see move
+	std::vector<uint64_t> marks;
+	std::vector<State> states;					//state 0 matched nothing yet
+	std::unordered_map<std::vector<int>, int, SetHash> index;	//states by their nondeterministic states and accepts
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,385 @@
+/*
+ *  Reharmonizer.h
+ *  MusicTheory
+ *
+ *  Beam search over the substitution space of a progression.
+ *
+ */
+
+#ifndef _Reharmonizer
+#define _Reharmonizer
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "Progression.h"
+#include "Scale.h"
+
+namespace MusicTheory{
+
+/*
+ Tuning knobs for Reharmonizer::reharmonize.
+ Costs are summed per slot, lower is better.
+ */
+	struct ReharmonizerSettings {
+		int beamWidth = 16;					//partial progressions kept after each slot
+		int topK = 5;						//number of complete reharmonizations returned
+		int threads = 0;					//0 = std::thread::hardware_concurrency()
+		double timeBudgetMs = 0;			//0 = no budget. When exceeded remaining slots are filled greedily
+		float melodyWeight = 1.0;			//weight of melody/chord compatibility
+		float voiceLeadingWeight = 0.5;		//weight of voice-leading distance between neighbouring chords
+		float substitutionPenalty = 0.1;	//cost of replacing the seed chord, keeps results close to the original
+		float pruneMargin = 4.0;			//expansions worse than best+margin are dropped before ranking
+		bool ignoreSuffix = false;			//passed on to the Progression::substitute* functions
+	};
+
+
+	struct Reharmonization {
+		std::vector<std::string> functions;	//eg. {"I","VI","IIm7","V7"}
+		std::deque<ChordPtr> chords;
+		float cost = 0;
+		bool withinBudget = true;			//false if the time budget cut the search short
+	};
+
+
+
+class Reharmonizer {
+
+  public:
+
+	/*
+	 Searches substitutions of a comma separated roman progression against a melody.
+	 The melody is spread evenly over the slots of the progression.
+	 {{{
+	 >>> Reharmonizer::reharmonize(melody, "I,VI,II7,V7", Note::create("C"))
+	 }}}
+	 */
+	static std::vector<Reharmonization> reharmonize(std::deque<NotePtr> melody, std::string progression, NotePtr key = Note::create("C"), ReharmonizerSettings settings = ReharmonizerSettings()) {
+		std::vector<std::string> seed = utils::splitString(progression, ",");
+		std::vector<std::deque<NotePtr>> perSlot(seed.size());
+
+		if (seed.size()) {
+			for (int i = 0; i < (int)melody.size(); i++) {
+				int slot = (i * (int)seed.size()) / (int)melody.size();
+				perSlot[slot].push_back(melody[i]);
+			}
+		}
+		return reharmonize(perSlot, seed, key, settings);
+	}
+
+
+	/*
+	 Same as above but with melody notes already assigned to each chord slot.
+	 */
+	static std::vector<Reharmonization> reharmonize(std::vector<std::deque<NotePtr>> melody, std::vector<std::string> seed, NotePtr key = Note::create("C"), ReharmonizerSettings settings = ReharmonizerSettings()) {
+		std::vector<Reharmonization> result;
+		if (!seed.size() || !key) {
+#ifdef LOGS
+			ofLogError() << "Reharmonizer::reharmonize failed. Empty progression or no key" << std::endl;
+#endif // LOGS
+			return result;
+		}
+		melody.resize(seed.size());
+
+		auto start = std::chrono::steady_clock::now();
+
+		//Everything touching Chord/Scale runs here on the calling thread.
+		//Their lookups and caches are not thread safe, the search below only sees plain data.
+		std::vector<std::vector<Candidate>> slots(seed.size());
+		for (int s = 0; s < (int)seed.size(); s++) {
+			slots[s] = Reharmonizer::getCandidates(seed[s], melody[s], key, settings);
+			if (!slots[s].size()) {
+#ifdef LOGS
+				ofLogError() << "Reharmonizer::reharmonize failed. No chord for " << seed[s] << std::endl;
+#endif // LOGS
+				return result;
+			}
+		}
+
+		std::vector<std::vector<float>> transitions(seed.size());
+		for (int s = 1; s < (int)seed.size(); s++) {
+			transitions[s].resize(slots[s - 1].size() * slots[s].size());
+			for (int a = 0; a < (int)slots[s - 1].size(); a++) {
+				for (int b = 0; b < (int)slots[s].size(); b++) {
+					transitions[s][a * slots[s].size() + b] = settings.voiceLeadingWeight * Reharmonizer::voiceLeadingCost(slots[s - 1][a].pitches, slots[s][b].pitches);
+				}
+			}
+		}
+
+		int width = std::max(settings.beamWidth, std::max(settings.topK, 1));
+		int threads = settings.threads > 0 ? settings.threads : std::max(1, (int)std::thread::hardware_concurrency());
+
+		std::vector<Beam> beams;
+		for (int c = 0; c < (int)slots[0].size(); c++) {
+			Beam b;
+			b.path.push_back(c);
+			b.cost = slots[0][c].cost;
+			beams.push_back(b);
+		}
+		Reharmonizer::prune(beams, width, settings.pruneMargin);
+
+		bool withinBudget = true;
+		for (int s = 1; s < (int)seed.size(); s++) {
+			if (withinBudget && settings.timeBudgetMs > 0) {
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+				withinBudget = elapsed.count() < settings.timeBudgetMs;
+			}
+
+			if (!withinBudget) {
+				//out of time, finish every beam greedily with its cheapest continuation
+				for (int b = 0; b < (int)beams.size(); b++) {
+					beams[b] = Reharmonizer::expand(beams[b], slots[s], transitions[s], 1)[0];
+				}
+				continue;
+			}
+
+			//expand beams in parallel, each worker takes a contiguous chunk
+			int workers = std::min(threads, (int)beams.size());
+			std::vector<Beam> next;
+			if (workers <= 1) {
+				for (int b = 0; b < (int)beams.size(); b++) {
+					std::vector<Beam> e = Reharmonizer::expand(beams[b], slots[s], transitions[s], width);
+					next.insert(next.end(), e.begin(), e.end());
+				}
+			}
+			else {
+				std::vector<std::future<std::vector<Beam>>> jobs;
+				int chunk = ((int)beams.size() + workers - 1) / workers;
+				for (int first = 0; first < (int)beams.size(); first += chunk) {
+					int last = std::min((int)beams.size(), first + chunk);
+					jobs.push_back(std::async(std::launch::async, [&, first, last]() {
+						std::vector<Beam> local;
+						for (int b = first; b < last; b++) {
+							std::vector<Beam> e = Reharmonizer::expand(beams[b], slots[s], transitions[s], width);
+							local.insert(local.end(), e.begin(), e.end());
+						}
+						return local;
+					}));
+				}
+				for (int j = 0; j < (int)jobs.size(); j++) {
+					std::vector<Beam> e = jobs[j].get();
+					next.insert(next.end(), e.begin(), e.end());
+				}
+			}
+
+			Reharmonizer::prune(next, width, settings.pruneMargin);
+			beams.swap(next);
+		}
+
+		std::sort(beams.begin(), beams.end(), [](const Beam& a, const Beam& b) { return a.cost < b.cost; });
+
+		for (int b = 0; b < (int)beams.size() && (int)result.size() < settings.topK; b++) {
+			Reharmonization r;
+			r.cost = beams[b].cost;
+			r.withinBudget = withinBudget;
+			for (int s = 0; s < (int)beams[b].path.size(); s++) {
+				const Candidate& c = slots[s][beams[b].path[s]];
+				r.functions.push_back(c.function);
+				r.chords.push_back(c.chord->copy());
+			}
+			result.push_back(r);
+		}
+
+		return result;
+	}
+
+
+	/*
+	 All substitutions the Progression module offers for one chord function,
+	 the function itself first. Duplicates are removed.
+	 {{{
+	 >>> Reharmonizer::getSubstitutions("VII")
+	 ["VII", "V", "IIdim", "IVdim", ...]
+	 }}}
+	 */
+	static std::vector<std::string> getSubstitutions(std::string chordFunction, bool ignoreSuffix = false) {
+		std::vector<std::string> result = { chordFunction };
+		std::vector<std::vector<std::string>> subs = {
+			Progression::substituteHarmonic(chordFunction, ignoreSuffix),
+			Progression::substituteMinorForMajor(chordFunction, ignoreSuffix),
+			Progression::substituteMajorForMinor(chordFunction, ignoreSuffix),
+			Progression::substituteDiminishedForDiminished(chordFunction, ignoreSuffix),
+			Progression::substituteDiminishedForDominant(chordFunction, ignoreSuffix)
+		};
+		for (int i = 0; i < (int)subs.size(); i++) {
+			for (int j = 0; j < (int)subs[i].size(); j++) {
+				if (std::find(result.begin(), result.end(), subs[i][j]) == result.end()) {
+					result.push_back(subs[i][j]);
+				}
+			}
+		}
+		return result;
+	}
+
+
+	/*
+	 How well melody notes sit on a chord, 0 is a perfect fit.
+	 Chord tones are free, notes in the best matching chord scale cost half
+	 and notes outside every scale cost one. The sum is divided by the number of notes.
+	 */
+	static float melodyCost(ChordPtr chord, std::deque<NotePtr>& melody) {
+		if (!melody.size() || !chord || !chord->notes.size()) {
+			return 0;
+		}
+		int chordMask = Reharmonizer::getPitchClassMask(chord->notes);
+
+		std::vector<int> scaleMasks;
+		std::vector<ScalePtr> scales = Scale::getScalesForChord(chord);
+		for (int i = 0; i < (int)scales.size(); i++) {
+			if (scales[i]) {
+				scaleMasks.push_back(Reharmonizer::getPitchClassMask(scales[i]->notes));
+			}
+		}
+		if (!scaleMasks.size()) {
+			scaleMasks.push_back(chordMask);
+		}
+
+		float best = melody.size();
+		for (int s = 0; s < (int)scaleMasks.size(); s++) {
+			float cost = 0;
+			for (int i = 0; i < (int)melody.size(); i++) {
+				int bit = 1 << Reharmonizer::pitchClass(melody[i]);
+				if (chordMask & bit) {
+					continue;
+				}
+				cost += (scaleMasks[s] & bit) ? 0.5 : 1.0;
+			}
+			best = std::min(best, cost);
+		}
+		return best / melody.size();
+	}
+
+
+	/*
+	 Average distance in semitones (0-6) each pitch class has to travel to
+	 the nearest pitch class of the other chord, measured both ways.
+	 */
+	static float voiceLeadingCost(const std::vector<int>& from, const std::vector<int>& to) {
+		if (!from.size() || !to.size()) {
+			return 0;
+		}
+		int total = 0;
+		for (int i = 0; i < (int)to.size(); i++) {
+			total += Reharmonizer::nearest(to[i], from);
+		}
+		for (int i = 0; i < (int)from.size(); i++) {
+			total += Reharmonizer::nearest(from[i], to);
+		}
+		return (float)total / (from.size() + to.size());
+	}
+
+
+  private:
+
+	struct Candidate {
+		std::string function;
+		ChordPtr chord;
+		std::vector<int> pitches;	//distinct pitch classes
+		float cost = 0;				//melody fit + substitution penalty
+	};
+
+	struct Beam {
+		std::vector<short> path;	//candidate index per slot
+		float cost = 0;
+	};
+
+
+	static std::vector<Candidate> getCandidates(std::string chordFunction, std::deque<NotePtr>& melody, NotePtr key, ReharmonizerSettings& settings) {
+		std::vector<Candidate> result;
+		std::vector<std::string> functions = Reharmonizer::getSubstitutions(chordFunction, settings.ignoreSuffix);
+
+		for (int i = 0; i < (int)functions.size(); i++) {
+			ChordPtr chord = Progression::getChordfromChordFunction(functions[i], key);
+			if (!chord || !chord->notes.size()) {
+				continue;
+			}
+			Candidate c;
+			c.function = functions[i];
+			c.chord = chord;
+			int mask = Reharmonizer::getPitchClassMask(chord->notes);
+			for (int pc = 0; pc < 12; pc++) {
+				if (mask & (1 << pc)) {
+					c.pitches.push_back(pc);
+				}
+			}
+			c.cost = settings.melodyWeight * Reharmonizer::melodyCost(chord, melody);
+			if (i > 0) {
+				c.cost += settings.substitutionPenalty;
+			}
+			result.push_back(c);
+		}
+		return result;
+	}
+
+
+	//best `limit` continuations of one beam, cheapest first
+	static std::vector<Beam> expand(const Beam& beam, const std::vector<Candidate>& slot, const std::vector<float>& transition, int limit) {
+		std::vector<Beam> result;
+		int from = beam.path.back();
+		for (int c = 0; c < (int)slot.size(); c++) {
+			Beam b;
+			b.cost = beam.cost + slot[c].cost + transition[from * slot.size() + c];
+			b.path = beam.path;
+			b.path.push_back(c);
+			result.push_back(b);
+		}
+		auto byCost = [](const Beam& a, const Beam& b) { return a.cost < b.cost; };
+		if ((int)result.size() > limit) {
+			std::partial_sort(result.begin(), result.begin() + limit, result.end(), byCost);
+			result.resize(limit);
+		}
+		else {
+			std::sort(result.begin(), result.end(), byCost);
+		}
+		return result;
+	}
+
+
+	//drops beams outside the margin of the best one, then keeps the `width` cheapest
+	static void prune(std::vector<Beam>& beams, int width, float margin) {
+		if (!beams.size()) {
+			return;
+		}
+		auto byCost = [](const Beam& a, const Beam& b) { return a.cost < b.cost; };
+		float best = std::min_element(beams.begin(), beams.end(), byCost)->cost;
+		beams.erase(std::remove_if(beams.begin(), beams.end(), [&](const Beam& b) { return b.cost > best + margin; }), beams.end());
+		if ((int)beams.size() > width) {
+			std::nth_element(beams.begin(), beams.begin() + width, beams.end(), byCost);
+			beams.resize(width);
+		}
+	}
+
+
+	static int nearest(int pc, const std::vector<int>& pitches) {
+		int best = 6;
+		for (int i = 0; i < (int)pitches.size(); i++) {
+			int d = std::abs(pc - pitches[i]) % 12;
+			best = std::min(best, std::min(d, 12 - d));
+		}
+		return best;
+	}
+
+
+	static int pitchClass(NotePtr n) {
+		return ((n->toInt(true) % 12) + 12) % 12;
+	}
+
+
+	static int getPitchClassMask(std::deque<NotePtr>& notes) {
+		int mask = 0;
+		for (int i = 0; i < (int)notes.size(); i++) {
+			if (notes[i]) {
+				mask |= 1 << Reharmonizer::pitchClass(notes[i]);
+			}
+		}
+		return mask;
+	}
+
+};//class
+
+
+}//namespace
+
+#endif
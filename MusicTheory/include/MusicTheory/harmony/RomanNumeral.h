@@ -0,0 +1,286 @@
+/*
+ *  RomanNumeral.h
+ *  MusicTheory
+ *
+ *  Single pass roman numeral tokenizer used by Progression and Interval,
+ *  and the tables Progression uses to name a chord's function in a key.
+ *  Nothing here allocates and everything is constexpr, so chord functions
+ *  known at compile time can be checked with static_assert.
+ *
+ */
+
+#ifndef _RomanNumeral
+#define _RomanNumeral
+
+#include <string_view>
+#include <vector>
+
+namespace MusicTheory{
+
+/*
+ Plain data equivalent of ChordTuple.
+ {{{
+ "bVIIdim7" -> degree 6, accidentals -1, suffix "dim7"
+ "ii"       -> degree 1, accidentals 0, lowercase, suffix ""
+ }}}
+ The suffix is a view into the tokenized string and lives as long as it does.
+ */
+	struct RomanToken {
+		int degree = 0;				//0-6 for I-VII
+		int accidentals = 0;		//sharps minus flats in front of the numeral
+		int prefixLength = 0;		//characters taken by accidentals (and spaces)
+		int numeralLength = 0;		//characters taken by the numeral
+		bool lowercase = false;		//eg. ii, vi
+		bool valid = false;			//false if no known numeral was found
+		std::string_view suffix;	//eg. m7, dim, 7
+
+		//semitones above the key, eg. bIII = 3
+		constexpr int semitones() const {
+			constexpr int offsets[7] = { 0, 2, 4, 5, 7, 9, 11 };
+			return offsets[degree] + accidentals;
+		}
+	};
+
+
+/*
+ A chord's function in a key as plain numbers, what Progression::getFunction
+ returns. Turned into text only when asked, eg. degree 2, accidentals -1,
+ symbol Chord::getSymbolId("m7") is "bIIIm7".
+ */
+	struct RomanFunction {
+		int degree = 0;				//0-6 for I-VII
+		int accidentals = 0;		//root against the major scale degree, see RomanNumeral::getPrefix
+		int symbol = -1;			//Chord::getSymbolId, -1 if unknown
+		bool valid = false;
+	};
+
+
+
+class RomanNumeral {
+
+  public:
+
+	/*
+	 Splits a chord function into accidentals, numeral and suffix in one pass.
+	 Spaces are skipped, case is ignored for the numeral itself.
+	 {{{
+	 >>> RomanNumeral::tokenize("#IVm7b5")
+	 degree 3, accidentals 1, suffix "m7b5"
+	 }}}
+	 */
+	static constexpr RomanToken tokenize(std::string_view str) {
+		RomanToken token;
+		size_t i = 0;
+		size_t end = str.size();
+		while (end > 0 && str[end - 1] == ' ') {
+			end--;
+		}
+
+		//accidentals, only counted if a numeral follows
+		int acc = 0;
+		size_t p = i;
+		while (p < end && (str[p] == '#' || str[p] == 'b' || str[p] == ' ')) {
+			if (str[p] == '#') {
+				acc++;
+			}
+			else if (str[p] == 'b') {
+				acc--;
+			}
+			p++;
+		}
+		if (p < end && RomanNumeral::isNumeralChar(str[p])) {
+			token.accidentals = acc;
+			i = p;
+		}
+		else {
+			while (i < end && str[i] == ' ') {
+				i++;
+			}
+		}
+		token.prefixLength = (int)i;
+
+		//longest run of i/v, matched against the seven numerals
+		size_t start = i;
+		int ones = 0, fives = 0;
+		bool fiveSeen = false, oneBeforeFive = false, lower = false;
+		while (i < end && RomanNumeral::isNumeralChar(str[i])) {
+			char c = str[i];
+			lower = lower || c == 'i' || c == 'v';
+			if (c == 'v' || c == 'V') {
+				fives++;
+				fiveSeen = true;
+			}
+			else {
+				ones++;
+				if (!fiveSeen) {
+					oneBeforeFive = true;
+				}
+			}
+			i++;
+		}
+		token.numeralLength = (int)(i - start);
+		token.lowercase = lower;
+
+		if (fives == 0 && ones >= 1 && ones <= 3) {
+			token.degree = ones - 1;			//I II III
+			token.valid = true;
+		}
+		else if (fives == 1 && ones == 1 && oneBeforeFive) {
+			token.degree = 3;					//IV
+			token.valid = true;
+		}
+		else if (fives == 1 && ones <= 2 && !oneBeforeFive) {
+			token.degree = 4 + ones;			//V VI VII
+			token.valid = true;
+		}
+
+		while (i < end && str[i] == ' ') {
+			i++;
+		}
+		token.suffix = str.substr(i, end - i);
+		return token;
+	}
+
+
+	/*
+	 Tokenizes a comma separated progression into `out`, reusing its capacity.
+	 Returns the number of valid chord functions.
+	 {{{
+	 >>> RomanNumeral::tokenize("I,VIm7,IIm7,V7", tokens)
+	 4
+	 }}}
+	 */
+	static int tokenize(std::string_view progression, std::vector<RomanToken>& out) {
+		out.clear();
+		int valid = 0;
+		size_t first = 0;
+		while (first <= progression.size()) {
+			size_t comma = progression.find(',', first);
+			if (comma == std::string_view::npos) {
+				comma = progression.size();
+			}
+			out.push_back(RomanNumeral::tokenize(progression.substr(first, comma - first)));
+			valid += out.back().valid ? 1 : 0;
+			first = comma + 1;
+		}
+		return valid;
+	}
+
+
+	/*
+	 Upper case numeral for a degree 0-6, eg. 4 -> "V"
+	 */
+	static constexpr std::string_view getNumeral(int degree) {
+		constexpr std::string_view numerals[7] = { "I", "II", "III", "IV", "V", "VI", "VII" };
+		return numerals[((degree % 7) + 7) % 7];
+	}
+
+
+	static constexpr bool isNumeralChar(char c) {
+		return c == 'i' || c == 'I' || c == 'v' || c == 'V';
+	}
+
+
+	/*
+	 Function of a root given only as semitones above the key. Uses the same
+	 spellings as Interval::toRoman: flats, and bV rather than #IV.
+	 {{{
+	 >>> RomanNumeral::fromSemitones(3)
+	 degree 2, accidentals -1 (bIII)
+	 }}}
+	 */
+	static constexpr RomanFunction fromSemitones(int semitones) {
+		constexpr int degrees[12] = { 0, 1, 1, 2, 2, 3, 4, 4, 5, 5, 6, 6 };
+		constexpr int accidentals[12] = { 0, -1, 0, -1, 0, 0, -1, 0, -1, 0, -1, 0 };
+		int s = ((semitones % 12) + 12) % 12;
+		RomanFunction f;
+		f.degree = degrees[s];
+		f.accidentals = accidentals[s];
+		f.valid = true;
+		return f;
+	}
+
+	/*
+	 Function of a spelled root in a spelled key, the numeral follows the
+	 letters so D# in C is #II and Eb is bIII. Gives the same answer as
+	 naming Interval::determine(key, root), without building any strings.
+	 Invalid if either name does not start with a note letter.
+	 */
+	static constexpr RomanFunction fromSpelling(std::string_view key, std::string_view root) {
+		RomanFunction f;
+		int keyLetter = RomanNumeral::getLetter(key);
+		int rootLetter = RomanNumeral::getLetter(root);
+		if (keyLetter < 0 || rootLetter < 0) {
+			return f;
+		}
+		f.valid = true;
+		f.degree = (rootLetter - keyLetter + 7) % 7;
+		int keyAccidentals = RomanNumeral::countAccidentals(key);
+		int rootAccidentals = RomanNumeral::countAccidentals(root);
+		if (f.degree == 0) {
+			f.accidentals = rootAccidentals - keyAccidentals;
+			return f;
+		}
+		//as Interval::measure, which works on pitch classes that are not wrapped below C or above B
+		constexpr int letterPitch[7] = { 0, 2, 4, 5, 7, 9, 11 };
+		constexpr int major[7] = { 0, 2, 4, 5, 7, 9, 11 };
+		int half = (letterPitch[rootLetter] + rootAccidentals) % 12 - (letterPitch[keyLetter] + keyAccidentals) % 12;
+		if (half < 0) {
+			half += 12;
+		}
+		f.accidentals = half - major[f.degree];
+		return f;
+	}
+
+	/*
+	 Accidental in front of the numeral. Anything sharp is one #, anything
+	 flatter than b is bb, as Progression has always written them.
+	 */
+	static constexpr std::string_view getPrefix(int accidentals) {
+		return accidentals > 0 ? "#" : accidentals == -1 ? "b" : accidentals < -1 ? "bb" : "";
+	}
+
+	//long form of getPrefix, eg. "minor "
+	static constexpr std::string_view getQualityName(int accidentals) {
+		return accidentals > 0 ? "augmented " : accidentals == -1 ? "minor " : accidentals < -1 ? "diminished " : "";
+	}
+
+	//eg. 4 -> "dominant"
+	static constexpr std::string_view getFunctionName(int degree) {
+		constexpr std::string_view names[7] = { "tonic", "supertonic", "mediant", "subdominant", "dominant", "submediant", "leadingtone" };
+		return names[((degree % 7) + 7) % 7];
+	}
+
+	//0-6 for C-B from the first character of a note name, -1 if it is not a note letter
+	static constexpr int getLetter(std::string_view name) {
+		if (name.empty()) {
+			return -1;
+		}
+		char c = name[0];
+		if (c >= 'a' && c <= 'g') {
+			c = c - 'a' + 'A';
+		}
+		constexpr int letters[7] = { 5, 6, 0, 1, 2, 3, 4 };//A-G
+		return (c >= 'A' && c <= 'G') ? letters[c - 'A'] : -1;
+	}
+
+	//sharps minus flats after the letter
+	static constexpr int countAccidentals(std::string_view name) {
+		int n = 0;
+		for (size_t i = 1; i < name.size(); i++) {
+			n += name[i] == '#' ? 1 : name[i] == 'b' ? -1 : 0;
+		}
+		return n;
+	}
+
+};//class
+
+
+	static_assert(RomanNumeral::tokenize("bVIIdim7").degree == 6 && RomanNumeral::tokenize("bVIIdim7").suffix == "dim7");
+	static_assert(RomanNumeral::tokenize("#ivm7").semitones() == 6 && RomanNumeral::tokenize("#ivm7").lowercase);
+	static_assert(RomanNumeral::fromSpelling("C", "D#").degree == 1 && RomanNumeral::getPrefix(RomanNumeral::fromSpelling("C", "D#").accidentals) == "#");
+	static_assert(RomanNumeral::fromSpelling("Eb", "Db").degree == 6 && RomanNumeral::fromSpelling("Eb", "Db").accidentals == -1);
+
+}//namespace
+
+#endif
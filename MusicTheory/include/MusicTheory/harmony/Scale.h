@@ -43,6 +43,7 @@
 #include <filesystem>
 #include <fstream>
 
+#include "Config.h"
 #include "Interval.h"
 #include "Note.h"
 #include "Diatonic.h"
@@ -68,7 +69,11 @@ M   ionian
 Any chord found in this list will replace these options for only that chord
 */
 
-	static Lookup ChordScaleLookup = {
+#ifdef MUSICTHEORY_TABLES_EXTERN
+	Lookup makeChordScaleLookup();
+#else
+	MUSICTHEORY_INLINE Lookup makeChordScaleLookup() {
+		return {
 		//Triads
 		{"m","dorian,aeolian"},
 		{"M","ionian"},
@@ -174,7 +179,10 @@ Any chord found in this list will replace these options for only that chord
 
 
 
-	};
+		};
+	}
+#endif
+	inline constexpr LazyTable<Lookup, &makeChordScaleLookup> ChordScaleLookup;
 
 	//
 	//
@@ -196,7 +204,7 @@ Any chord found in this list will replace these options for only that chord
 
 
 		static std::shared_ptr<Scale>create() {
-			return std::shared_ptr<Scale>(new Scale());
+			return Allocation::make<Scale>();
 		}
 
 		/*
@@ -204,7 +212,7 @@ Any chord found in this list will replace these options for only that chord
 		eg. A dorian
 		*/
 		static std::shared_ptr<Scale>create(std::string fullName) {
-			std::shared_ptr<Scale> s = std::shared_ptr<Scale>(new Scale());
+			std::shared_ptr<Scale> s = Allocation::make<Scale>();
 
 			auto parts = utils::splitString(fullName, " ");
 			if (parts.size() == 2) {
@@ -217,7 +225,7 @@ Any chord found in this list will replace these options for only that chord
 		}
 
 		std::shared_ptr<Scale> copy() {
-			std::shared_ptr<Scale>s = std::shared_ptr<Scale>(new Scale(*this));
+			std::shared_ptr<Scale>s = Allocation::make<Scale>(*this);
 			s->notes.clear();
 			for (NotePtr n : notes) {
 				s->notes.push_back(n->copy());
@@ -2244,6 +2252,7 @@ Any chord found in this list will replace these options for only that chord
 
 
 		static std::vector<std::shared_ptr<Scale>> getScalesForChord(ChordPtr chord) {
+			MUSICTHEORY_TIME(InstrumentTimer::ScalesForChord);
 			std::vector<std::shared_ptr<Scale>> scalesInKey;
 			std::string str = ChordScaleLookup[chord->getChordSymbol()];
 
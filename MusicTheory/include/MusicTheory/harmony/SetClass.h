@@ -0,0 +1,437 @@
+/*
+ *  SetClass.h
+ *  MusicTheory
+ *
+ *  Set class analysis for post-tonal music. Any set of pitch classes
+ *  belongs to one of 224 classes under transposition and inversion, named
+ *  by Forte number, eg. 4-Z15, with its prime form, interval class vector
+ *  and symmetries.
+ *
+ *  {{{
+ *  >>> SetClasses::get(Chord::create("C7")->notes).name
+ *  "4-27"
+ *  >>> SetClasses::getNormalForm(SetClasses::getPitchClasses(Chord::create("C7")->notes))
+ *  [4, 7, 10, 0]
+ *  >>> SetClasses::get("6-Z29").intervalVector
+ *  [2, 2, 4, 2, 3, 2]
+ *  }}}
+ *
+ *  Pitch class sets are 12 bit ints, bit n for pitch class n, C = 0. All
+ *  4096 of them are classified once, on first use, so every lookup after
+ *  that is an index into a table.
+ *
+ *  Prime forms are Forte's, packed to the left. rahnPrimeForm has Rahn's
+ *  where the two differ: 5-20, 6-Z29, 6-31, 7-Z18, 7-20 and 8-26.
+ *
+ */
+
+#ifndef _SetClass
+#define _SetClass
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Chord.h"
+#include "Scale.h"
+
+namespace MusicTheory{
+
+	struct SetClass {
+		int index = 0;			//in SetClasses::getAll()
+		int cardinality = 0;
+		int number = 1;			//Forte's, the 15 of 4-Z15
+		bool isZ = false;
+		std::string name;		//eg. "4-Z15"
+		int primeForm = 0;		//12 bit set, eg. 0b10010001 for 3-11 (037)
+		int rahnPrimeForm = 0;
+		std::array<int, 6> intervalVector = {};	//how many of each interval class, 1 to 6
+		int zPartner = -1;		//index of the class with the same interval vector, -1 if none
+		int complement = 0;		//index of the class of the complement, 7-n for 5-n
+		int transpositionalSymmetry = 1;	//how many Tn map the set onto itself, T0 included
+		int inversionalSymmetry = 0;		//how many TnI do
+	};
+
+
+	//where a pitch class set sits in its class
+	struct PitchClassSet {
+		int pitchClasses = 0;
+		int setClass = 0;		//index in SetClasses::getAll()
+		int normalForm = 0;		//pitch class the normal form starts on
+		int transposition = 0;	//the set is Tn of the prime form, or TnI if inverted
+		bool inverted = false;
+	};
+
+
+
+class SetClasses {
+
+  public:
+
+	static const SetClass& get(int pitchClasses) {
+		const Table& t = SetClasses::getTable();
+		return t.classes[t.sets[pitchClasses & 0xFFF].setClass];
+	}
+
+	static const SetClass& get(const std::deque<NotePtr>& notes) {
+		return SetClasses::get(SetClasses::getPitchClasses(notes));
+	}
+
+	static const SetClass& get(ChordPtr chord) {
+		return SetClasses::get(chord ? SetClasses::getPitchClasses(chord->notes) : 0);
+	}
+
+	static const SetClass& get(ScalePtr scale) {
+		return SetClasses::get(scale ? SetClasses::getPitchClasses(scale->notes) : 0);
+	}
+
+	/*
+	 By Forte name, with or without the Z, eg. "4-Z15" or "4-15". Returns
+	 the empty set class 0-1 if there is no such class.
+	 */
+	static const SetClass& get(const std::string& name) {
+		const Table& t = SetClasses::getTable();
+		size_t dash = name.find('-');
+		if (dash == std::string::npos || dash == 0) {
+			return t.classes[0];
+		}
+		std::string cardinality = name.substr(0, dash);
+		std::string number = name.substr(dash + 1);
+		if (number.size() && (number[0] == 'Z' || number[0] == 'z')) {
+			number = number.substr(1);
+		}
+		if (!SetClasses::isNumber(cardinality) || !SetClasses::isNumber(number)) {
+			return t.classes[0];
+		}
+		int c = std::stoi(cardinality);
+		int n = std::stoi(number);
+		for (const SetClass& s : t.classes) {
+			if (s.cardinality == c && s.number == n) {
+				return s;
+			}
+		}
+		return t.classes[0];
+	}
+
+	static const PitchClassSet& getPitchClassSet(int pitchClasses) {
+		return SetClasses::getTable().sets[pitchClasses & 0xFFF];
+	}
+
+	//all 224, by cardinality then Forte number
+	static const std::vector<SetClass>& getAll() {
+		return SetClasses::getTable().classes;
+	}
+
+	static std::vector<const SetClass*> getAll(int cardinality) {
+		std::vector<const SetClass*> result;
+		for (const SetClass& s : SetClasses::getAll()) {
+			if (s.cardinality == cardinality) {
+				result.push_back(&s);
+			}
+		}
+		return result;
+	}
+
+
+	static int getPitchClasses(const std::deque<NotePtr>& notes) {
+		int pitchClasses = 0;
+		for (const NotePtr& n : notes) {
+			if (n && n->name.size()) {
+				pitchClasses |= 1 << (((n->toInt(true) % 12) + 12) % 12);
+			}
+		}
+		return pitchClasses;
+	}
+
+	/*
+	 Forte's normal order: the rotation spanning the smallest interval,
+	 ties going to the one packed most to the left.
+	 */
+	static std::vector<int> getNormalForm(int pitchClasses) {
+		const PitchClassSet& s = SetClasses::getPitchClassSet(pitchClasses);
+		std::vector<int> result;
+		for (int i = 0; i < 12; i++) {
+			int pc = (s.normalForm + i) % 12;
+			if (s.pitchClasses & (1 << pc)) {
+				result.push_back(pc);
+			}
+		}
+		return result;
+	}
+
+	static std::vector<int> getPrimeForm(int pitchClasses) {
+		return SetClasses::toList(SetClasses::get(pitchClasses).primeForm);
+	}
+
+	//pitch classes in a set, ascending
+	static std::vector<int> toList(int pitchClasses) {
+		std::vector<int> result;
+		for (int pc = 0; pc < 12; pc++) {
+			if (pitchClasses & (1 << pc)) {
+				result.push_back(pc);
+			}
+		}
+		return result;
+	}
+
+	static std::array<int, 6> getIntervalVector(int pitchClasses) {
+		std::array<int, 6> v;
+		for (int ic = 1; ic <= 6; ic++) {
+			v[ic - 1] = SetClasses::bitCount(pitchClasses & SetClasses::transpose(pitchClasses, ic));
+		}
+		v[5] /= 2;//the tritone is its own inversion, each pair was counted twice
+		return v;
+	}
+
+	/*
+	 Interval class vectors of count sets at once, six counts per set into
+	 vectors. Straight line code over plain arrays so the compiler can
+	 vectorise the loop.
+	 */
+	static void getIntervalVectors(const uint16_t* sets, size_t count, uint8_t* vectors) {
+		for (size_t i = 0; i < count; i++) {
+			uint32_t s = sets[i] & 0xFFF;
+			uint32_t doubled = s | (s << 12);//rotating is then a shift
+			for (int ic = 1; ic <= 6; ic++) {
+				uint32_t shared = s & (doubled >> (12 - ic)) & 0xFFF;
+				shared = shared - ((shared >> 1) & 0x555);
+				shared = (shared & 0x333) + ((shared >> 2) & 0x333);
+				shared = (shared + (shared >> 4)) & 0xF0F;
+				shared = (shared + (shared >> 8)) & 0x1F;
+				vectors[i * 6 + ic - 1] = (uint8_t)(shared >> (ic == 6));
+			}
+		}
+	}
+
+
+	static int transpose(int pitchClasses, int semitones) {
+		semitones = ((semitones % 12) + 12) % 12;
+		return ((pitchClasses << semitones) | (pitchClasses >> (12 - semitones))) & 0xFFF;
+	}
+
+	//about C, n to -n
+	static int invert(int pitchClasses) {
+		int result = pitchClasses & 1;
+		for (int pc = 1; pc < 12; pc++) {
+			if (pitchClasses & (1 << pc)) {
+				result |= 1 << (12 - pc);
+			}
+		}
+		return result;
+	}
+
+	static int complement(int pitchClasses) {
+		return ~pitchClasses & 0xFFF;
+	}
+
+
+  private:
+
+	struct Table {
+		std::vector<SetClass> classes;
+		std::vector<PitchClassSet> sets;//by pitch class set, 4096
+	};
+
+
+	/*
+	 Forte's prime forms for three to six notes in the order of his
+	 numbering, pitch classes in hex. Seven to nine note classes are the
+	 complements of these, 7-n of 5-n and so on.
+	 */
+	static const std::vector<std::vector<const char*>>& getForteList() {
+		static const std::vector<std::vector<const char*>> list = {
+			{ "012", "013", "014", "015", "016", "024", "025", "026", "027", "036", "037", "048" },
+			{ "0123", "0124", "0134", "0125", "0126", "0127", "0145", "0156", "0167", "0235",
+			  "0135", "0236", "0136", "0237", "0146", "0157", "0347", "0147", "0148", "0158",
+			  "0246", "0247", "0257", "0248", "0268", "0358", "0258", "0369", "0137" },
+			{ "01234", "01235", "01245", "01236", "01237", "01256", "01267", "02346", "01246", "01346",
+			  "02347", "01356", "01248", "01257", "01268", "01347", "01348", "01457", "01367", "01378",
+			  "01458", "01478", "02357", "01357", "02358", "02458", "01358", "02368", "01368", "01468",
+			  "01369", "01469", "02468", "02469", "02479", "01247", "03458", "01258" },
+			{ "012345", "012346", "012356", "012456", "012367", "012567", "012678", "023457", "012357", "013457",
+			  "012457", "012467", "013467", "013458", "012458", "014568", "012478", "012578", "013478", "014589",
+			  "023468", "012468", "023568", "013468", "013568", "013578", "013469", "013569", "013689", "013679",
+			  "013589", "024579", "023579", "013579", "02468a", "012347", "012348", "012378", "023458", "012358",
+			  "012368", "012369", "012568", "012569", "023469", "012469", "012479", "012579", "013479", "014679" }
+		};
+		return list;
+	}
+
+	static const Table& getTable() {
+		static const Table table = []() {
+			Table t;
+			std::vector<int> primes;//Forte prime form of each class, by index
+
+			auto addClass = [&](int cardinality, int number, int prime) {
+				SetClass s;
+				s.index = (int)t.classes.size();
+				s.cardinality = cardinality;
+				s.number = number;
+				s.primeForm = prime;
+				t.classes.push_back(s);
+				primes.push_back(prime);
+			};
+
+			addClass(0, 1, 0);
+			addClass(1, 1, 1);
+			for (int ic = 1; ic <= 6; ic++) {
+				addClass(2, ic, 1 | (1 << ic));
+			}
+			const std::vector<std::vector<const char*>>& forte = SetClasses::getForteList();
+			for (int c = 3; c <= 6; c++) {
+				const std::vector<const char*>& list = forte[c - 3];
+				for (int n = 0; n < (int)list.size(); n++) {
+					int prime = 0;
+					for (const char* pc = list[n]; *pc; pc++) {
+						prime |= 1 << (*pc >= 'a' ? *pc - 'a' + 10 : *pc - '0');
+					}
+					addClass(c, n + 1, prime);
+				}
+			}
+			//the complements, 7-n of 5-n and so on
+			int small = (int)primes.size();
+			for (int c = 7; c <= 12; c++) {
+				for (int i = 0; i < small; i++) {
+					if (t.classes[i].cardinality == 12 - c) {
+						addClass(c, t.classes[i].number, SetClasses::getFortePrime(SetClasses::complement(primes[i])));
+					}
+				}
+			}
+
+			//every set to its class
+			std::vector<int> classOfPrime(4096, -1);
+			for (int i = 0; i < (int)primes.size(); i++) {
+				classOfPrime[primes[i]] = i;
+			}
+			t.sets.resize(4096);
+			for (int m = 0; m < 4096; m++) {
+				PitchClassSet& s = t.sets[m];
+				s.pitchClasses = m;
+				s.setClass = classOfPrime[SetClasses::getFortePrime(m)];
+				s.normalForm = SetClasses::getNormalOrderStart(m);
+				int prime = primes[s.setClass];
+				for (int n = 0; n < 12; n++) {
+					if (SetClasses::transpose(prime, n) == m) {
+						s.transposition = n;
+						s.inverted = false;
+						break;
+					}
+					if (SetClasses::transpose(SetClasses::invert(prime), n) == m) {
+						s.transposition = n;
+						s.inverted = true;
+						break;
+					}
+				}
+			}
+
+			for (SetClass& s : t.classes) {
+				s.rahnPrimeForm = SetClasses::getRahnPrime(s.primeForm);
+				s.intervalVector = SetClasses::getIntervalVector(s.primeForm);
+				s.complement = t.sets[SetClasses::complement(s.primeForm)].setClass;
+				s.transpositionalSymmetry = 0;
+				s.inversionalSymmetry = 0;
+				int inversion = SetClasses::invert(s.primeForm);
+				for (int n = 0; n < 12; n++) {
+					s.transpositionalSymmetry += SetClasses::transpose(s.primeForm, n) == s.primeForm;
+					s.inversionalSymmetry += SetClasses::transpose(inversion, n) == s.primeForm;
+				}
+			}
+			for (SetClass& s : t.classes) {
+				for (const SetClass& other : t.classes) {
+					if (other.index != s.index && other.cardinality == s.cardinality && other.intervalVector == s.intervalVector) {
+						s.zPartner = other.index;
+						s.isZ = true;
+					}
+				}
+				s.name = std::to_string(s.cardinality) + "-" + (s.isZ ? "Z" : "") + std::to_string(s.number);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+
+	//rotation of the set starting on the returned pitch class, Forte's normal order
+	static int getNormalOrderStart(int pitchClasses) {
+		std::vector<int> pcs = SetClasses::toList(pitchClasses);
+		if (!pcs.size()) {
+			return 0;
+		}
+		int best = 0;
+		std::vector<int> bestKey;
+		for (int r = 0; r < (int)pcs.size(); r++) {
+			std::vector<int> key = SetClasses::getForteKey(SetClasses::transpose(pitchClasses, -pcs[r]));
+			if (r == 0 || key < bestKey) {
+				best = pcs[r];
+				bestKey = key;
+			}
+		}
+		return best;
+	}
+
+	//span, then the pitch classes from the left, of a set transposed to start on 0
+	static std::vector<int> getForteKey(int pitchClasses) {
+		std::vector<int> key = SetClasses::toList(pitchClasses);
+		key.insert(key.begin(), key.back());
+		return key;
+	}
+
+	//the pitch classes from the right
+	static std::vector<int> getRahnKey(int pitchClasses) {
+		std::vector<int> key = SetClasses::toList(pitchClasses);
+		std::reverse(key.begin(), key.end());
+		return key;
+	}
+
+	template <class KeyFunction>
+	static int getPrime(int pitchClasses, KeyFunction getKey) {
+		if (!pitchClasses) {
+			return 0;
+		}
+		int best = -1;
+		std::vector<int> bestKey;
+		for (int form : { pitchClasses, SetClasses::invert(pitchClasses) }) {
+			for (int n = 0; n < 12; n++) {
+				int candidate = SetClasses::transpose(form, -n);
+				if (!(candidate & 1)) {
+					continue;
+				}
+				std::vector<int> key = getKey(candidate);
+				if (best < 0 || key < bestKey) {
+					best = candidate;
+					bestKey = key;
+				}
+			}
+		}
+		return best;
+	}
+
+	static int getFortePrime(int pitchClasses) {
+		return SetClasses::getPrime(pitchClasses, SetClasses::getForteKey);
+	}
+
+	static int getRahnPrime(int pitchClasses) {
+		return SetClasses::getPrime(pitchClasses, SetClasses::getRahnKey);
+	}
+
+
+	static int bitCount(int x) {
+		int n = 0;
+		for (; x; x &= x - 1) {
+			n++;
+		}
+		return n;
+	}
+
+	static bool isNumber(const std::string& s) {
+		return s.size() && s.size() < 4 && std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; });
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ *  Tuning.h
+ *  MusicTheory
+ *
+ *  Frequencies for all 128 midi notes (C-3 = 60, A-3 = 69) under a tuning
+ *  system, computed once when the Tuning is made. Note to Hz is a table
+ *  lookup, Hz to nearest note + cents is a log2 and a step or two.
+ *
+ *  {{{
+ *  Tuning t = Tuning::pythagorean(Note::create("D"));
+ *  t.toHertz(69)               -> 440
+ *  t.fromHertz(445.0).cents    -> 19.56
+ *  Tuning s = Tuning::fromScala("19edo.scl", "19edo.kbm");
+ *  }}}
+ *
+ */
+
+#ifndef _Tuning
+#define _Tuning
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Note.h"
+
+namespace MusicTheory{
+
+	/*
+	 Result of Tuning::fromHertz.
+	 */
+	struct PitchEstimate {
+		int pitch = -1;		//nearest midi note, -1 if the tuning maps none
+		float cents = 0;	//deviation from that note, positive is sharp
+	};
+
+
+
+class Tuning {
+
+  public:
+
+	static const int NOTES = 128;
+
+
+	/*
+	 12-TET with A-3 (midi 69) at reference.
+	 */
+	Tuning(double reference = 440.0) {
+		std::vector<double> cents;
+		for (int i = 0; i < 12; i++) {
+			cents.push_back(i * 100.0);
+		}
+		build(cents, 1200.0, std::vector<int>(), 0, 69, reference);
+		equal = true;
+	}
+
+	static Tuning equalTemperament(double reference = 440.0) {
+		return Tuning(reference);
+	}
+
+	/*
+	 5-limit just intonation on tonic, A-3 stays at reference.
+	 */
+	static Tuning justIntonation(NotePtr tonic = Note::create("C"), double reference = 440.0) {
+		static const double ratios[12] = { 1.0, 16.0 / 15, 9.0 / 8, 6.0 / 5, 5.0 / 4, 4.0 / 3, 45.0 / 32, 3.0 / 2, 8.0 / 5, 5.0 / 3, 9.0 / 5, 15.0 / 8 };
+		return Tuning::fromRatios(ratios, tonic, reference);
+	}
+
+	/*
+	 Pure fifths from tonic, diminished fifth (not augmented fourth) on the tritone.
+	 */
+	static Tuning pythagorean(NotePtr tonic = Note::create("C"), double reference = 440.0) {
+		static const double ratios[12] = { 1.0, 256.0 / 243, 9.0 / 8, 32.0 / 27, 81.0 / 64, 4.0 / 3, 1024.0 / 729, 3.0 / 2, 128.0 / 81, 27.0 / 16, 16.0 / 9, 243.0 / 128 };
+		return Tuning::fromRatios(ratios, tonic, reference);
+	}
+
+	/*
+	 Meantone, fifths narrowed by a fraction of the syntonic comma, 0.25 is
+	 quarter comma. The chain of fifths runs from Eb to G# as seen from C.
+	 */
+	static Tuning meantone(NotePtr tonic = Note::create("C"), double commaFraction = 0.25, double reference = 440.0) {
+		double comma = 1200.0 * std::log2(81.0 / 80.0);
+		double fifth = 1200.0 * std::log2(1.5) - commaFraction * comma;
+		std::vector<double> cents(12);
+		for (int j = -3; j <= 8; j++) {
+			int pc = ((j * 7) % 12 + 12) % 12;
+			double c = std::fmod(j * fifth, 1200.0);
+			cents[pc] = c < 0 ? c + 1200.0 : c;
+		}
+		Tuning t;
+		t.build(cents, 1200.0, std::vector<int>(), tonic->toInt(true), 69, reference);
+		return t;
+	}
+
+
+	/*
+	 Scala scale file, and optionally a keyboard mapping (.kbm) file.
+	 Without a mapping degree 0 sits on midi 60 and midi 69 gets 440 Hz.
+	 Returns 12-TET if the scale can't be read.
+	 */
+	static Tuning fromScala(std::string sclPath, std::string kbmPath = "") {
+		std::string scl = Tuning::readFile(sclPath);
+		std::string kbm = kbmPath.size() ? Tuning::readFile(kbmPath) : "";
+		return Tuning::fromScalaString(scl, kbm);
+	}
+
+	/*
+	 Same as fromScala but takes the file contents.
+	 */
+	static Tuning fromScalaString(std::string scl, std::string kbm = "") {
+		Tuning t;
+		std::vector<std::string> lines = Tuning::getScalaLines(scl);
+		//description, count, then one pitch per line
+		if (lines.size() < 2) {
+			return t;
+		}
+		int count = std::atoi(lines[1].c_str());
+		if (count < 1 || (int)lines.size() < 2 + count) {
+			return t;
+		}
+		std::vector<double> cents(1, 0.0);
+		for (int i = 0; i < count; i++) {
+			cents.push_back(Tuning::parseScalaPitch(lines[2 + i]));
+		}
+		double period = cents.back();
+		cents.pop_back();
+
+		int middle = 60;
+		int referenceNote = 69;
+		double referenceFrequency = 440.0;
+		std::vector<int> mapping;
+		int octaveDegree = 0;
+		int firstNote = 0;
+		int lastNote = NOTES - 1;
+
+		std::vector<std::string> keys = Tuning::getScalaLines(kbm);
+		int keyCount = (int)keys.size();
+		if (keyCount >= 7) {
+			int mapSize = std::atoi(keys[0].c_str());
+			firstNote = std::atoi(keys[1].c_str());
+			lastNote = std::atoi(keys[2].c_str());
+			middle = std::atoi(keys[3].c_str());
+			referenceNote = std::atoi(keys[4].c_str());
+			referenceFrequency = std::atof(keys[5].c_str());
+			octaveDegree = std::atoi(keys[6].c_str());
+			for (int i = 0; i < mapSize; i++) {
+				bool unmapped = 7 + i >= keyCount || keys[7 + i][0] == 'x';
+				mapping.push_back(unmapped ? UNMAPPED : std::atoi(keys[7 + i].c_str()));
+			}
+		}
+		t.build(cents, period, mapping, middle, referenceNote, referenceFrequency, octaveDegree, firstNote, lastNote);
+		return t;
+	}
+
+
+	/*
+	 Hz of a midi note, 0 for notes the tuning leaves unmapped.
+	 */
+	double toHertz(int pitch) const {
+		return pitch >= 0 && pitch < NOTES ? frequencies[pitch] : 0.0;
+	}
+
+	double toHertz(NotePtr note) const {
+		return toHertz(note->toInt());
+	}
+
+	/*
+	 Nearest note of this tuning and the deviation from it in cents.
+	 {{{
+	 >>> Tuning().fromHertz(450.0)
+	 pitch 69, cents 38.9
+	 }}}
+	 */
+	PitchEstimate fromHertz(double hertz) const {
+		PitchEstimate e;
+		if (hertz <= 0) {
+			return e;
+		}
+		double l = std::log2(hertz);
+		int p = (int)std::lround((l - firstLog) * slope) + firstMapped;
+		p = std::max(firstMapped, std::min(lastMapped, p));
+		if (!equal) {
+			p = nearest(l, p);
+		}
+		if (p < 0 || frequencies[p] <= 0) {
+			return e;
+		}
+		e.pitch = p;
+		e.cents = (float)(1200.0 * (l - logs[p]));
+		return e;
+	}
+
+	/*
+	 Note spelled with sharps, as Note::fromInt does.
+	 */
+	NotePtr getNote(double hertz, float* cents = nullptr) const {
+		PitchEstimate e = fromHertz(hertz);
+		if (cents) {
+			*cents = e.cents;
+		}
+		return e.pitch < 0 ? NotePtr() : Note::fromInt(e.pitch);
+	}
+
+
+	/*
+	 Whole buffers at once, eg. a block of pitch track frames. Plain loops
+	 over contiguous arrays so the compiler can vectorise them.
+	 */
+	void toHertz(const int* pitches, float* out, int size) const {
+		for (int i = 0; i < size; i++) {
+			int p = pitches[i];
+			out[i] = p >= 0 && p < NOTES ? (float)frequencies[p] : 0.0f;
+		}
+	}
+
+	void fromHertz(const float* hertz, int* pitches, float* cents, int size) const {
+		if (equal) {
+			//closed form, no table walk
+			float ref = (float)logs[69];
+			for (int i = 0; i < size; i++) {
+				float l = std::log2(std::max(hertz[i], 1e-6f));
+				float v = 69.0f + 12.0f * (l - ref);
+				float r = std::min(127.0f, std::max(0.0f, std::nearbyint(v)));
+				pitches[i] = hertz[i] > 0 ? (int)r : -1;
+				cents[i] = hertz[i] > 0 ? (v - r) * 100.0f : 0.0f;
+			}
+			return;
+		}
+		for (int i = 0; i < size; i++) {
+			PitchEstimate e = fromHertz(hertz[i]);
+			pitches[i] = e.pitch;
+			cents[i] = e.cents;
+		}
+	}
+
+
+	/*
+	 Cents of pitch relative to 12-TET at the same reference.
+	 */
+	double getDeviation(int pitch) const {
+		if (pitch < 0 || pitch >= NOTES || frequencies[pitch] <= 0) {
+			return 0;
+		}
+		return 1200.0 * (logs[pitch] - logs[69]) - (pitch - 69) * 100.0;
+	}
+
+	bool isEqualTemperament() const {
+		return equal;
+	}
+
+
+  private:
+
+	static const int UNMAPPED = -1;
+
+	double frequencies[NOTES];
+	double logs[NOTES];
+	bool equal = false;
+	//first guess for fromHertz, notes per octave in log2 space
+	double firstLog = 0;
+	double slope = 12;
+	int firstMapped = 0;
+	int lastMapped = NOTES - 1;
+
+
+	static Tuning fromRatios(const double* ratios, NotePtr tonic, double reference) {
+		std::vector<double> cents;
+		for (int i = 0; i < 12; i++) {
+			cents.push_back(1200.0 * std::log2(ratios[i]));
+		}
+		Tuning t;
+		t.build(cents, 1200.0, std::vector<int>(), tonic->toInt(true), 69, reference);
+		return t;
+	}
+
+	/*
+	 cents: scale degrees from 0, period: cents of the repeating interval,
+	 mapping: keyboard map from the middle note, empty = linear,
+	 referenceNote sounds at referenceFrequency.
+	 As in Scala, each repeat of the mapping moves octaveDegree scale
+	 degrees (0 = the scale size), and notes outside firstNote to lastNote
+	 keep 12-TET at A-3 = 440.
+	 */
+	void build(const std::vector<double>& cents, double period, const std::vector<int>& mapping, int middle, int referenceNote, double referenceFrequency, int octaveDegree = 0, int firstNote = 0, int lastNote = NOTES - 1) {
+		equal = false;
+		int size = (int)cents.size();
+		double absolute[NOTES];
+		bool mapped[NOTES];
+		for (int n = 0; n < NOTES; n++) {
+			int degree = n - middle;
+			if (mapping.size()) {
+				int m = (int)mapping.size();
+				int index = ((degree % m) + m) % m;
+				int repeats = (degree - index) / m;
+				mapped[n] = mapping[index] != UNMAPPED;
+				degree = mapped[n] ? mapping[index] + repeats * (octaveDegree > 0 ? octaveDegree : size) : 0;
+			}
+			else {
+				mapped[n] = true;
+			}
+			int d = ((degree % size) + size) % size;
+			int octaves = (degree - d) / size;
+			absolute[n] = octaves * period + cents[d];
+		}
+		//the reference may itself be unmapped, its would-be position still anchors the rest
+		double anchor = referenceNote >= 0 && referenceNote < NOTES ? absolute[referenceNote] : 0;
+
+		firstMapped = -1;
+		lastMapped = -1;
+		for (int n = 0; n < NOTES; n++) {
+			if (n < firstNote || n > lastNote) {
+				mapped[n] = true;
+				frequencies[n] = 440.0 * std::pow(2.0, (n - 69) / 12.0);
+			}
+			else {
+				frequencies[n] = mapped[n] ? referenceFrequency * std::pow(2.0, (absolute[n] - anchor) / 1200.0) : 0.0;
+			}
+			logs[n] = mapped[n] ? std::log2(frequencies[n]) : 0.0;
+			if (mapped[n]) {
+				if (firstMapped < 0) {
+					firstMapped = n;
+				}
+				lastMapped = n;
+			}
+		}
+		if (firstMapped < 0) {
+			firstMapped = lastMapped = 0;
+			return;
+		}
+		firstLog = logs[firstMapped];
+		double range = logs[lastMapped] - firstLog;
+		slope = range > 0 ? (lastMapped - firstMapped) / range : 12;
+	}
+
+	//walks from the guess to the closest mapped note in log2 space
+	int nearest(double l, int p) const {
+		auto distance = [&](int n) {
+			return frequencies[n] > 0 ? std::abs(l - logs[n]) : 1e9;
+		};
+		int best = p;
+		while (best > firstMapped && distance(best - 1) <= distance(best)) {
+			best--;
+		}
+		while (best < lastMapped && distance(best + 1) < distance(best)) {
+			best++;
+		}
+		//skip over unmapped keys next to the guess
+		if (frequencies[best] <= 0) {
+			for (int r = 1; r < NOTES; r++) {
+				if (best - r >= firstMapped && frequencies[best - r] > 0) {
+					return best - r;
+				}
+				if (best + r <= lastMapped && frequencies[best + r] > 0) {
+					return best + r;
+				}
+			}
+			return -1;
+		}
+		return best;
+	}
+
+
+	static std::string readFile(std::string path) {
+		std::ifstream file(path);
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	//non comment lines, trimmed
+	static std::vector<std::string> getScalaLines(const std::string& text) {
+		std::vector<std::string> lines;
+		std::stringstream ss(text);
+		std::string line;
+		while (std::getline(ss, line)) {
+			if (line.size() && line[0] == '!') {
+				continue;
+			}
+			size_t first = line.find_first_not_of(" \t\r");
+			size_t last = line.find_last_not_of(" \t\r");
+			line = first == std::string::npos ? "" : line.substr(first, last - first + 1);
+			//the description may be empty, everything after it may not
+			if (line.size() || lines.empty()) {
+				lines.push_back(line);
+			}
+		}
+		return lines;
+	}
+
+	/*
+	 "701.955" is cents, "3/2" or "2" a ratio.
+	 */
+	static double parseScalaPitch(const std::string& line) {
+		std::string value = line.substr(0, line.find_first_of(" \t"));
+		if (value.find('.') != std::string::npos) {
+			return std::atof(value.c_str());
+		}
+		size_t slash = value.find('/');
+		double num = std::atof(value.substr(0, slash).c_str());
+		double den = slash == std::string::npos ? 1.0 : std::atof(value.substr(slash + 1).c_str());
+		return num > 0 && den > 0 ? 1200.0 * std::log2(num / den) : 0.0;
+	}
+
+};//class
+
+}//namespace
+
+#endif
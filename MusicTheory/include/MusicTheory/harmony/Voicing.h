@@ -0,0 +1,144 @@
+/*
+ *  Voicing.h
+ *  MusicTheory
+ *
+ *  A chord voicing as a small fixed array of midi pitches (C-3 = 60).
+ *  Inversions and drop voicings work on the pitches directly, nothing
+ *  allocates. Chord::getVoicing() returns one, and the Chord inversion
+ *  functions implement the same operations on NotePtrs.
+ *
+ */
+
+#ifndef _Voicing
+#define _Voicing
+
+namespace MusicTheory{
+
+	struct Voicing {
+
+		static const int MAX_NOTES = 16;
+
+		int pitches[MAX_NOTES] = {};//ascending after any operation below
+		int size = 0;
+
+
+		constexpr void add(int pitch) {
+			if (size < MAX_NOTES) {
+				pitches[size++] = pitch;
+			}
+		}
+
+		constexpr int bass() const {
+			return size ? pitches[0] : 0;
+		}
+
+		constexpr int top() const {
+			return size ? pitches[size - 1] : 0;
+		}
+
+		constexpr int span() const {
+			return top() - bass();
+		}
+
+		/*
+		 Pitch classes as a 12 bit set, bit 0 = C.
+		 */
+		constexpr int getPitchClassMask() const {
+			int mask = 0;
+			for (int i = 0; i < size; i++) {
+				mask |= 1 << Voicing::pitchClass(pitches[i]);
+			}
+			return mask;
+		}
+
+		//insertion sort, voicings are tiny
+		constexpr void sort() {
+			for (int i = 1; i < size; i++) {
+				int p = pitches[i];
+				int j = i - 1;
+				while (j >= 0 && pitches[j] > p) {
+					pitches[j + 1] = pitches[j];
+					j--;
+				}
+				pitches[j + 1] = p;
+			}
+		}
+
+
+		/*
+		 Moves every note below the lowest root up by octaves so the root is
+		 in the bass. Rootless voicings are left alone.
+		 >>> C/E [52, 60, 64, 67] root 0 -> [60, 64, 64, 67]
+		 */
+		constexpr void toRootPosition(int rootClass) {
+			sort();
+			int r = -1;
+			for (int i = 0; i < size && r < 0; i++) {
+				if (Voicing::pitchClass(pitches[i]) == Voicing::pitchClass(rootClass)) {
+					r = i;
+				}
+			}
+			if (r <= 0) {
+				return;
+			}
+			int rootPitch = pitches[r];
+			for (int i = 0; i < r; i++) {
+				pitches[i] += 12 * ((rootPitch - pitches[i]) / 12 + 1);
+			}
+			sort();
+		}
+
+		/*
+		 Lowest note up an octave, `times` times.
+		 */
+		constexpr void invert(int times = 1) {
+			sort();
+			for (int t = 0; t < times && size > 1; t++) {
+				pitches[0] += 12;
+				sort();
+			}
+		}
+
+		/*
+		 nth inversion counted from root position, 0 is root position.
+		 */
+		constexpr void setInversion(int rootClass, int n) {
+			toRootPosition(rootClass);
+			invert(n);
+		}
+
+		/*
+		 Drops the nth voice from the top an octave, drop(2) is a drop-2 voicing.
+		 Does nothing if there are not enough voices.
+		 */
+		constexpr void drop(int voice) {
+			sort();
+			int i = size - voice;
+			if (voice < 1 || i < 0) {
+				return;
+			}
+			pitches[i] -= 12;
+			sort();
+		}
+
+		constexpr bool operator==(const Voicing& other) const {
+			if (size != other.size) {
+				return false;
+			}
+			for (int i = 0; i < size; i++) {
+				if (pitches[i] != other.pitches[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static constexpr int pitchClass(int pitch) {
+			return ((pitch % 12) + 12) % 12;
+		}
+
+	};
+
+}//namespace
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ *  VoicingGenerator.h
+ *  MusicTheory
+ *
+ *  Lazily enumerates voicings of a chord: every inversion, with or without
+ *  drop-2, drop-3 and drop-2+4, with voices spread up an octave, placed in
+ *  every octave that fits a pitch range. Candidates are plain Voicings
+ *  produced one at a time, no ChordPtr is created.
+ *
+ *  {{{
+ *  VoicingGenerator gen(Chord::create("Cmaj7"));
+ *  gen.addShapeFilter([](const Voicing& v){ return v.span() <= 19; });
+ *  for (const Voicing& v : gen) {
+ *      ...
+ *  }
+ *  }}}
+ *
+ */
+
+#ifndef _VoicingGenerator
+#define _VoicingGenerator
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "Chord.h"
+#include "Voicing.h"
+
+namespace MusicTheory{
+
+	struct VoicingRange {
+		int lowest = 40;			//lowest pitch allowed, E1 (C-3 = 60)
+		int highest = 84;			//highest pitch allowed, C5
+		int maxSpan = 36;			//bass to top
+		int maxSpreadVoices = 1;	//how many voices may be raised an extra octave
+		bool inversions = true;
+		bool drops = true;
+	};
+
+	//return false to reject the candidate
+	typedef std::function<bool(const Voicing&)> VoicingFilter;
+
+
+class VoicingGenerator {
+
+  public:
+
+	//drop variants in enumeration order
+	static const int NO_DROP = 0;
+	static const int DROP_2 = 1;
+	static const int DROP_3 = 2;
+	static const int DROP_2_4 = 3;
+
+
+	VoicingGenerator(const Voicing& chordVoicing, int rootClass, VoicingRange _range = VoicingRange()) {
+		source = chordVoicing;
+		source.toRootPosition(rootClass);
+		range = _range;
+		reset();
+	}
+
+	VoicingGenerator(ChordPtr chord, VoicingRange _range = VoicingRange()) {
+		range = _range;
+		if (chord && chord->isValid()) {
+			source = chord->getVoicing();
+			source.toRootPosition(chord->getBassPitch() + chord->getRootOffset());
+		}
+		reset();
+	}
+
+
+	/*
+	 Runs once per shape, before it is placed in any octave. Rejecting a
+	 shape prunes all its placements, so put anything octave independent
+	 (span, gaps, voice count) here.
+	 */
+	void addShapeFilter(VoicingFilter f) {
+		shapeFilters.push_back(f);
+	}
+
+	/*
+	 Runs on every placed candidate, eg. for melody or range checks.
+	 */
+	void addFilter(VoicingFilter f) {
+		filters.push_back(f);
+	}
+
+
+	/*
+	 Writes the next candidate into `out`. Returns false when exhausted.
+	 */
+	bool next(Voicing& out) {
+		while (true) {
+			if (hasShape && octave <= lastOctave) {
+				out = shape;
+				for (int i = 0; i < out.size; i++) {
+					out.pitches[i] += 12 * octave;
+				}
+				octave++;
+				if (VoicingGenerator::passes(out, filters)) {
+					return true;
+				}
+				continue;
+			}
+			if (!advanceShape()) {
+				return false;
+			}
+		}
+	}
+
+	/*
+	 Calls f for each candidate until f returns false. Returns the number visited.
+	 */
+	template <class F>
+	int forEach(F f) {
+		reset();
+		Voicing v;
+		int count = 0;
+		while (next(v)) {
+			count++;
+			if (!f(v)) {
+				break;
+			}
+		}
+		return count;
+	}
+
+	void reset() {
+		inversion = 0;
+		drop = 0;
+		spread = -1;
+		hasShape = false;
+		octave = 0;
+		lastOctave = -1;
+		shapes.clear();
+	}
+
+
+	/*
+	 Input iterator so the generator works in a range for.
+	 */
+	class iterator {
+	  public:
+		iterator(VoicingGenerator* g = nullptr) : gen(g) {
+			if (gen && !gen->next(current)) {
+				gen = nullptr;
+			}
+		}
+		const Voicing& operator*() const { return current; }
+		const Voicing* operator->() const { return &current; }
+		iterator& operator++() {
+			if (gen && !gen->next(current)) {
+				gen = nullptr;
+			}
+			return *this;
+		}
+		bool operator==(const iterator& other) const { return gen == other.gen; }
+		bool operator!=(const iterator& other) const { return gen != other.gen; }
+	  private:
+		VoicingGenerator* gen;
+		Voicing current;
+	};
+
+	iterator begin() {
+		reset();
+		return iterator(this);
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+
+  private:
+
+	Voicing source;//root position, close
+	VoicingRange range;
+	std::vector<VoicingFilter> shapeFilters;
+	std::vector<VoicingFilter> filters;
+
+	//enumeration state
+	int inversion, drop, spread;
+	bool hasShape;
+	Voicing shape;
+	int octave, lastOctave;
+	std::vector<Voicing> shapes;//emitted so far, relative to the bass
+
+
+	//steps spread, then drop, then inversion until a shape passes
+	bool advanceShape() {
+		hasShape = false;
+		int voices = source.size;
+		if (voices < 1) {
+			return false;
+		}
+		int inversions = range.inversions ? voices : 1;
+		int drops = range.drops ? 4 : 1;
+		int spreads = 1 << (voices - 1);
+
+		while (inversion < inversions) {
+			spread++;
+			if (spread >= spreads) {
+				spread = 0;
+				drop++;
+			}
+			if (drop >= drops) {
+				drop = 0;
+				inversion++;
+				spread = -1;//next pass starts this inversion at spread 0
+				continue;
+			}
+			if (VoicingGenerator::bitCount(spread) > range.maxSpreadVoices) {
+				continue;
+			}
+			if (!VoicingGenerator::makeShape(source, inversion, drop, spread, shape)) {
+				continue;
+			}
+			if (shape.span() > range.maxSpan || !VoicingGenerator::passes(shape, shapeFilters)) {
+				continue;
+			}
+			//octaves that keep the shape inside the range
+			octave = VoicingGenerator::floorDiv(range.lowest - shape.bass() + 11, 12);
+			lastOctave = VoicingGenerator::floorDiv(range.highest - shape.top(), 12);
+			if (octave > lastOctave) {
+				continue;
+			}
+			//different inversions, drops and spreads can land on the same shape
+			if (!VoicingGenerator::addShape(shape, shapes)) {
+				continue;
+			}
+			hasShape = true;
+			return true;
+		}
+		return false;
+	}
+
+
+	//false if shapes already holds shape, up to octave
+	static bool addShape(const Voicing& shape, std::vector<Voicing>& shapes) {
+		Voicing relative = shape;
+		for (int i = 0; i < relative.size; i++) {
+			relative.pitches[i] -= shape.bass();
+		}
+		for (const Voicing& s : shapes) {
+			if (s.size == relative.size && std::equal(s.pitches, s.pitches + s.size, relative.pitches)) {
+				return false;
+			}
+		}
+		shapes.push_back(relative);
+		return true;
+	}
+
+
+	static bool makeShape(const Voicing& source, int inversion, int drop, int spread, Voicing& out) {
+		out = source;
+		out.invert(inversion);
+		int n = out.size;
+		if (drop == DROP_2) {
+			if (n < 3) {
+				return false;
+			}
+			out.drop(2);
+		}
+		else if (drop == DROP_3) {
+			if (n < 4) {
+				return false;
+			}
+			out.drop(3);
+		}
+		else if (drop == DROP_2_4) {
+			if (n < 4) {
+				return false;
+			}
+			//both counted on the voicing before dropping
+			out.pitches[n - 2] -= 12;
+			out.pitches[n - 4] -= 12;
+			out.sort();
+		}
+		for (int v = 1; v < n; v++) {
+			if (spread & (1 << (v - 1))) {
+				out.pitches[v] += 12;
+			}
+		}
+		out.sort();
+		return true;
+	}
+
+	static bool passes(const Voicing& v, const std::vector<VoicingFilter>& list) {
+		for (const VoicingFilter& f : list) {
+			if (!f(v)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static int bitCount(int x) {
+		int c = 0;
+		for (; x; x &= x - 1) {
+			c++;
+		}
+		return c;
+	}
+
+	static int floorDiv(int a, int b) {
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+};//class
+
+}//namespace
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ *  MusicTheory.cpp
+ *  MusicTheory
+ *
+ *  The compiled core. Holds the one definition of every table for
+ *  programs built with MUSICTHEORY_COMPILED_LIB, see harmony/Config.h.
+ *  Header only programs do not need it.
+ *
+ */
+
+#ifndef MUSICTHEORY_COMPILED_LIB
+#define MUSICTHEORY_COMPILED_LIB
+#endif
+#define MUSICTHEORY_CORE_SOURCE
+
+#include "../include/MusicTheory/MusicTheory.h"
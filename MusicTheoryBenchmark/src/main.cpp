@@ -0,0 +1,468 @@
+#include "MusicTheory/MusicTheory.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace MusicTheory;
+
+static const double TWO_PI = 6.283185307179586;
+
+/*
+ Benchmarks. Run the Release build, timings of Debug builds mean little.
+
+ MusicTheoryBenchmark [--filter text] [--min-time seconds] [--json file]
+
+ Every benchmark reports nanoseconds per call. --json also writes the
+ results in the Google Benchmark JSON layout, so its compare tools and
+ dashboards can track them between releases. Built with
+ MUSICTHEORY_INSTRUMENTATION the JSON also carries the library's counters.
+ */
+
+struct BenchmarkResult {
+    std::string name;
+    long long iterations = 0;
+    double nanoseconds = 0;//per iteration
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+static std::vector<BenchmarkResult> results;
+static std::string filter;
+static double minTime = 0.1;
+static volatile size_t sink;//results are written here so calls are not optimised away
+
+//--------------------------------------------------------------
+static bool selected(const std::string& name){
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+static void report(const BenchmarkResult& result){
+    std::cout<<result.name<<": "<<result.nanoseconds<<" ns ("<<result.iterations<<" iterations)";
+    for(auto& counter : result.counters){
+        std::cout<<", "<<counter.first<<" "<<counter.second;
+    }
+    std::cout<<std::endl;
+    results.push_back(result);
+}
+
+//--------------------------------------------------------------
+/*
+ Calls f in growing batches until a batch takes minTime, setup runs
+ untimed before every call (eg. to empty a cache).
+ */
+static void benchmark(std::string name, std::function<size_t()> f, std::function<void()> setup = nullptr){
+    if(!selected(name)){
+        return;
+    }
+    sink = f();//warm up, and first touch of any lazy tables
+    long long iterations = 1;
+    while(true){
+        double elapsed = 0;
+        if(setup){
+            for(long long i=0;i<iterations;i++){
+                setup();
+                auto start = std::chrono::steady_clock::now();
+                sink = f();
+                elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+        }else{
+            auto start = std::chrono::steady_clock::now();
+            for(long long i=0;i<iterations;i++){
+                sink = f();
+            }
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        if(elapsed >= minTime || iterations >= (1LL << 40)){
+            BenchmarkResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nanoseconds = elapsed * 1e9 / iterations;
+            report(result);
+            return;
+        }
+        //aim a little past minTime so most benchmarks finish in the next batch
+        double scale = elapsed > 0 ? 1.4 * minTime / elapsed : 10;
+        iterations = std::max(iterations + 1, (long long)(iterations * std::min(scale, 100.0)));
+    }
+}
+
+//--------------------------------------------------------------
+static std::string escape(const std::string& s){
+    std::string out;
+    for(char c : s){
+        if(c == '"' || c == '\\'){
+            out += '\\';
+        }
+        out += c;
+    }
+    return out;
+}
+
+static void writeJson(std::ostream& out){
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+#ifdef NDEBUG
+    std::string build = "release";
+#else
+    std::string build = "debug";
+#endif
+    out<<"{\n  \"context\": {\n";
+    out<<"    \"date\": \""<<date<<"\",\n";
+    out<<"    \"library_build_type\": \""<<build<<"\",\n";
+    out<<"    \"min_time\": "<<minTime;
+    if(Instrumentation::isEnabled()){
+        //counts over the whole run, with MUSICTHEORY_INSTRUMENTATION defined
+        out<<",\n    \"instrumentation\": "<<Instrumentation::toJson();
+    }
+    out<<"\n  },\n";
+    out<<"  \"benchmarks\": [\n";
+    for(int i=0;i<(int)results.size();i++){
+        const BenchmarkResult& r = results[i];
+        out<<"    {\"name\": \""<<escape(r.name)<<"\", \"run_type\": \"iteration\", \"iterations\": "<<r.iterations
+            <<", \"real_time\": "<<r.nanoseconds<<", \"cpu_time\": "<<r.nanoseconds<<", \"time_unit\": \"ns\"";
+        for(auto& counter : r.counters){
+            out<<", \""<<escape(counter.first)<<"\": "<<counter.second;
+        }
+        out<<"}"<<(i + 1 < (int)results.size() ? "," : "")<<"\n";
+    }
+    out<<"  ]\n}\n";
+}
+
+//--------------------------------------------------------------
+static void benchmarkNotes(){
+    benchmark("Note::create/C", [](){ return (size_t)Note::create("C")->toInt(); });
+    benchmark("Note::create/Ebb,5", [](){ return (size_t)Note::create("Ebb", 5)->toInt(); });
+    benchmark("Note::fromInt", [](){ return Note::fromInt(61)->name.size(); });
+    NotePtr note = Note::create("F#", 4);
+    benchmark("Note::toInt", [note](){ return (size_t)note->toInt(); });
+    benchmark("Note::copy", [note](){ return note->copy()->name.size(); });
+    benchmark("Note::transpose", [note](){
+        NotePtr n = note->copy();
+        n->transpose(4);
+        return n->name.size();
+    });
+}
+
+//--------------------------------------------------------------
+static void benchmarkIntervals(){
+    NotePtr c = Note::create("C");
+    NotePtr e = Note::create("E");
+    NotePtr key = Note::create("C");
+    benchmark("Interval::third", [c, key](){ return Interval::third(c, key)->name.size(); });
+    benchmark("Interval::majorThird", [c](){ return Interval::majorThird(c)->name.size(); });
+    benchmark("Interval::minorSeventh", [c](){ return Interval::minorSeventh(c)->name.size(); });
+    benchmark("Interval::measure", [c, e](){ return (size_t)Interval::measure(c, e); });
+    benchmark("Interval::determine", [c, e](){ return Interval::determine(c, e).size(); });
+    benchmark("Interval::determine/shorthand", [c, e](){ return Interval::determine(c, e, true).size(); });
+    benchmark("Interval::fromName", [c](){ return Interval::fromName(c, "b7")->name.size(); });
+}
+
+//--------------------------------------------------------------
+static void benchmarkDiatonic(){
+    for(std::string name : {"C", "F#", "Bb"}){
+        NotePtr key = Note::create(name);
+        benchmark("Diatonic::getNotes/cold/" + name, [key](){ return Diatonic::getNotes(key).size(); }, [](){ _keyCache.clear(); });
+        benchmark("Diatonic::getNotes/warm/" + name, [key](){ return Diatonic::getNotes(key).size(); });
+    }
+}
+
+//--------------------------------------------------------------
+static void benchmarkChords(){
+    std::vector<std::string> symbols;
+    for(auto it = ChordLookup.begin(); it != ChordLookup.end(); it++){
+        symbols.push_back(it->first);
+    }
+    for(std::string symbol : symbols){
+        std::string name = "C" + symbol;
+        benchmark("Chord::fromShorthand/" + name, [name](){
+            ChordPtr chord = Chord::fromShorthand(name);
+            return chord ? chord->notes.size() : 0;
+        });
+    }
+
+    //stacked thirds over C, wrapping into higher octaves past the seventh
+    const char* thirds[] = {"C", "E", "G", "B", "D", "F", "A"};
+    for(int size=2;size<=14;size++){
+        std::deque<NotePtr> notes;
+        for(int i=0;i<size;i++){
+            notes.push_back(Note::create(thirds[i % 7], 4 + i / 7));
+        }
+        benchmark("Chord::determine/" + std::to_string(size), [notes](){ return Chord::determine(notes, true).size(); });
+        benchmark("ChordDecomposer::decompose/" + std::to_string(size), [notes](){ return ChordDecomposer::decompose(notes).size(); });
+    }
+}
+
+//--------------------------------------------------------------
+static void benchmarkScales(){
+    for(std::string symbol : {"C", "Dm7", "G7", "Bm7b5", "Ebdim7", "F#7#9"}){
+        ChordPtr chord = Chord::fromShorthand(symbol);
+        benchmark("Scale::getScalesForChord/" + symbol, [chord](){ return Scale::getScalesForChord(chord).size(); });
+    }
+}
+
+//--------------------------------------------------------------
+static void benchmarkSetClasses(){
+    ChordPtr chord = Chord::fromShorthand("G7b9");
+    benchmark("SetClasses::get/G7b9", [chord](){ return (size_t)SetClasses::get(chord).index; });
+
+    //every pitch class set, one at a time and through the bulk kernel
+    std::vector<uint16_t> sets(4096);
+    for(int i=0;i<4096;i++){
+        sets[i] = (uint16_t)i;
+    }
+    std::vector<uint8_t> vectors(sets.size() * 6);
+    benchmark("SetClasses::getIntervalVector/4096", [sets](){
+        size_t n = 0;
+        for(uint16_t s : sets){
+            n += SetClasses::getIntervalVector(s)[0];
+        }
+        return n;
+    });
+    benchmark("SetClasses::getIntervalVectors/4096", [sets, vectors]() mutable {
+        SetClasses::getIntervalVectors(sets.data(), sets.size(), vectors.data());
+        return (size_t)vectors[6 * 4095];
+    });
+}
+
+//--------------------------------------------------------------
+static void benchmarkNeoRiemannian(){
+    ChordPtr from = Chord::fromShorthand("C");
+    ChordPtr to = Chord::fromShorthand("Ebm");
+    benchmark("NeoRiemannian::getDistance/C-Ebm", [from, to](){ return (size_t)NeoRiemannian::getDistance(from, to); });
+    benchmark("NeoRiemannian::getPath/C-Ebm", [from, to](){ return NeoRiemannian::getPath(from, to).size(); });
+
+    //every pair of triads
+    std::vector<int> a, b;
+    for(int i=0;i<NeoRiemannian::TRIADS;i++){
+        for(int j=0;j<NeoRiemannian::TRIADS;j++){
+            a.push_back(i);
+            b.push_back(j);
+        }
+    }
+    std::vector<uint8_t> distances(a.size());
+    benchmark("NeoRiemannian::getDistances/576", [a, b, distances]() mutable {
+        NeoRiemannian::getDistances(a.data(), b.data(), a.size(), distances.data());
+        return (size_t)distances.back();
+    });
+}
+
+//--------------------------------------------------------------
+static void benchmarkProgressions(){
+    struct Tune {
+        std::string name;
+        std::string chords;
+        std::string key;
+    };
+    std::vector<Tune> tunes = {
+        {"ii-V-I", "Dm7,G7,CM7", "C"},
+        {"pop", "C,G,Am,F,C,G,F,C", "C"},
+        {"blues", "C7,F7,C7,C7,F7,F7,C7,C7,G7,F7,C7,G7", "C"},
+        {"autumn leaves", "Cm7,F7,BbM7,EbM7,Am7b5,D7,Gm,Gm", "Bb"},
+        {"giant steps", "BM7,D7,GM7,Bb7,EbM7,Am7,D7,GM7,Bb7,EbM7,F#7,BM7,Fm7,Bb7,EbM7", "G"},
+        {"rhythm changes", "BbM7,G7,Cm7,F7,Dm7,G7,Cm7,F7,Fm7,Bb7,EbM7,Ab7,Dm7,G7,Cm7,F7", "Bb"}
+    };
+    for(Tune& tune : tunes){
+        benchmark("Progression::analyse/" + tune.name, [tune](){ return Progression::analyse(tune.chords, tune.key).size(); });
+        benchmark("Progression::quickAnalysis/" + tune.name, [tune](){ return Progression::quickAnalysis(tune.chords, tune.key).size(); });
+        benchmark("Progression::quickAnalysis/cold/" + tune.name, [tune](){ return Progression::quickAnalysis(tune.chords, tune.key).size(); }, [](){ Progression::getAnalysisCache().clear(); });
+    }
+    //ii-V-I in every key, after the first key the chords come from the analysis cache
+    std::vector<Tune> keys = {
+        {"", "Dm7,G7,CM7", "C"}, {"", "Ebm7,Ab7,DbM7", "Db"}, {"", "Em7,A7,DM7", "D"}, {"", "Fm7,Bb7,EbM7", "Eb"},
+        {"", "F#m7,B7,EM7", "E"}, {"", "Gm7,C7,FM7", "F"}, {"", "G#m7,C#7,F#M7", "F#"}, {"", "Am7,D7,GM7", "G"},
+        {"", "Bbm7,Eb7,AbM7", "Ab"}, {"", "Bm7,E7,AM7", "A"}, {"", "Cm7,F7,BbM7", "Bb"}, {"", "C#m7,F#7,BM7", "B"}
+    };
+    benchmark("Progression::quickAnalysis/cold/ii-V-I in 12 keys", [keys](){
+        size_t n = 0;
+        for(const Tune& key : keys){
+            n += Progression::quickAnalysis(key.chords, key.key).size();
+        }
+        return n;
+    }, [](){ Progression::getAnalysisCache().clear(); });
+}
+
+//--------------------------------------------------------------
+static std::vector<float> makeSignal(std::string shape, float hertz, float sampleRate, int size){
+    std::vector<float> signal(size);
+    double phase = 0;
+    double step = hertz / sampleRate;
+    for(int i=0;i<size;i++){
+        signal[i] = shape == "sine" ? 0.5f * (float)std::sin(TWO_PI * phase) : 0.5f * (float)(2 * phase - 1);
+        phase += step;
+        if(phase >= 1){
+            phase -= 1;
+        }
+    }
+    return signal;
+}
+
+//--------------------------------------------------------------
+static void benchmarkProgressionIndex(int size){
+    std::string name = "ProgressionIndex::search/" + std::to_string(size);
+    if(!selected(name)){
+        return;//building the corpus takes a while
+    }
+    //random walks over common numerals, 4 to 15 chords each
+    std::vector<uint16_t> numerals;
+    for(std::string numeral : {"I", "IIm", "IIIm", "IV", "V", "VIm", "IIm7", "V7", "IM7", "bVII", "IVm", "VI7", "II7", "III7", "bIIIM7", "#IVm7b5"}){
+        numerals.push_back(ProgressionIndex::getNumeralToken(numeral));
+    }
+    std::srand(1);
+    std::vector<std::vector<uint16_t>> corpus(size);
+    for(std::vector<uint16_t>& progression : corpus){
+        int length = 4 + std::rand() % 12;
+        for(int i=0;i<length;i++){
+            progression.push_back(numerals[std::rand() % numerals.size()]);
+        }
+    }
+    std::string path = "ProgressionIndex.benchmark.mtpi";
+    ProgressionIndex::write(corpus, path);
+    ProgressionIndex index;
+    index.open(path);
+    size_t next = 0;
+    benchmark(name, [&](){
+        return index.search(corpus[next++ % corpus.size()], 10).size();
+    });
+    index.close();
+    std::remove(path.c_str());
+}
+
+//--------------------------------------------------------------
+static void benchmarkProgressionPatterns(int size){
+    std::vector<uint16_t> numerals;
+    for(std::string numeral : {"I", "IIm", "IIIm", "IV", "V", "VIm", "IIm7", "V7", "IM7", "bVII7", "IVm", "VI7", "II7", "bII7", "IIm7b5", "Im"}){
+        numerals.push_back(ProgressionIndex::getNumeralToken(numeral));
+    }
+    std::srand(1);
+    std::vector<uint16_t> tokens(size);
+    for(uint16_t& token : tokens){
+        token = numerals[std::rand() % numerals.size()];
+    }
+    //the cadences in every key, the automaton is built on the first scan
+    ProgressionPatterns patterns;
+    for(auto& pattern : ProgressionPatterns::getDefaultPatterns()){
+        patterns.add(pattern.first, pattern.second, true);
+    }
+    benchmark("ProgressionPatterns::scan/defaults in 12 keys/" + std::to_string(size), [&](){
+        return patterns.scan(tokens).size();
+    });
+}
+
+//--------------------------------------------------------------
+static void benchmarkPitchTracker(std::string shape, float sampleRate, int blockSize){
+    std::ostringstream label;
+    label<<"PitchTracker/"<<shape<<"/"<<sampleRate<<"/"<<blockSize;
+    std::string name = label.str();
+    if(!selected(name)){
+        return;
+    }
+
+    const int midiNotes[] = {40, 45, 52, 57, 64, 69, 76, 81, 88};//E1 to E6
+    const int seconds = 2;
+
+    PitchTrackerSettings settings;
+    settings.sampleRate = sampleRate;
+    settings.windowSize = (int)(PitchTrackerSettings().windowSize * sampleRate / 44100);
+    settings.hopSize = blockSize;
+
+    double totalTime = 0;
+    long long blocks = 0;
+    double worstBlock = 0;
+    int correct = 0;
+    double centsError = 0;
+    int notes = 0;
+
+    Tuning tuning;
+    for(int midi : midiNotes){
+        float hertz = (float)tuning.toHertz(midi);
+        std::vector<float> signal = makeSignal(shape, hertz, sampleRate, (int)sampleRate * seconds);
+
+        PitchTracker tracker(settings, tuning);
+        std::vector<PitchEvent> events;
+        events.reserve(16);
+        for(int i=0;i + blockSize <= (int)signal.size();i += blockSize){
+            auto start = std::chrono::steady_clock::now();
+            tracker.process(signal.data() + i, blockSize, events);
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            totalTime += elapsed.count();
+            worstBlock = std::max(worstBlock, elapsed.count());
+            blocks++;
+        }
+        notes++;
+        if(events.size() && events[0].pitch == midi){
+            correct++;
+            centsError += std::abs(events[0].cents);
+        }
+    }
+
+    double blockMs = 1000.0 * blockSize / sampleRate;
+    double meanBlock = totalTime / blocks;
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = blocks;
+    result.nanoseconds = meanBlock * 1000.0;
+    result.counters = {
+        {"worst_ns", worstBlock * 1000.0},
+        {"realtime", blockMs * 1000.0 / meanBlock},
+        {"notes_correct", (double)correct},
+        {"notes", (double)notes},
+        {"cents_error", correct ? centsError / correct : 0}
+    };
+    report(result);
+}
+
+//--------------------------------------------------------------
+int main(int argc, char** argv){
+    std::string jsonFile;
+    for(int i=1;i<argc;i++){
+        std::string arg = argv[i];
+        if(arg == "--filter" && i + 1 < argc){
+            filter = argv[++i];
+        }else if(arg == "--min-time" && i + 1 < argc){
+            minTime = std::atof(argv[++i]);
+        }else if(arg == "--json" && i + 1 < argc){
+            jsonFile = argv[++i];
+        }else{
+            std::cout<<"usage: "<<argv[0]<<" [--filter text] [--min-time seconds] [--json file]"<<std::endl;
+            return 1;
+        }
+    }
+
+    benchmarkNotes();
+    benchmarkIntervals();
+    benchmarkDiatonic();
+    benchmarkChords();
+    benchmarkScales();
+    benchmarkSetClasses();
+    benchmarkNeoRiemannian();
+    benchmarkProgressions();
+    benchmarkProgressionIndex(1000000);
+    benchmarkProgressionPatterns(10000);
+
+    for(std::string shape : {"sine", "sawtooth"}){
+        for(float sampleRate : {44100.0f, 48000.0f, 96000.0f}){
+            benchmarkPitchTracker(shape, sampleRate, 256);
+            benchmarkPitchTracker(shape, sampleRate, 512);
+        }
+    }
+
+    if(jsonFile.size()){
+        std::ofstream out(jsonFile);
+        if(!out){
+            std::cout<<"could not write "<<jsonFile<<std::endl;
+            return 1;
+        }
+        writeJson(out);
+        std::cout<<"wrote "<<results.size()<<" results to "<<jsonFile<<std::endl;
+    }
+    return 0;
+}
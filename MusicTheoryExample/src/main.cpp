@@ -1,4 +1,5 @@
 #include "MusicTheory/MusicTheory.h"
+#include <algorithm>
 #include <iostream>
 #include <deque>
 #include <vector>
@@ -346,6 +347,23 @@ int main(){
     
     melMin = Scale::getScaleFromString(scales[0], Note::create("C",6));
     std::cout<<melMin<<std::endl;
+
+    //close position triad: root position and both inversions, each once
+    VoicingRange close;
+    close.drops = false;
+    close.maxSpreadVoices = 0;
+    VoicingGenerator closeGen(Chord::create("C"), close);
+    std::vector<std::vector<int>> shapes;
+    for(const Voicing& v : closeGen){
+        std::vector<int> shape;
+        for(int i=0;i<v.size;i++){
+            shape.push_back(v.pitches[i] - v.bass());
+        }
+        if(std::find(shapes.begin(), shapes.end(), shape) == shapes.end()){
+            shapes.push_back(shape);
+        }
+    }
+    std::cout<<"Close shapes of C: "<<shapes.size()<<(shapes.size() == 3 ? "" : " (expected 3)")<<std::endl;
     
 
     